@@ -1,40 +1,170 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "block_manager.h"
 
-void bm_init(BlockManager *bm) {
+#include <errno.h>
+
+static _Thread_local int t_group = -1;    /* Set on the first allocation */
+
+void bm_init(BlockManager *bm, int shared) {
     if (!bm) return;
-    for (int i = 0; i < FS_NUM_BLOCKS; ++i) {
-        bm->block_used[i] = 0;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    if (shared) {
+        /* Robust like the volume lock, so a client that dies while
+         * allocating does not wedge the group for every process */
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
     }
+    for (int g = 0; g < FS_ALLOC_GROUPS; ++g) {
+        pthread_mutex_init(&bm->groups[g].lock, &attr);
+        atomic_init(&bm->groups[g].used_count, 0);
+        bm->groups[g].high_water = 0;
+    }
+    atomic_init(&bm->next_group, 0);
+    atomic_init(&bm->claimed, 0);
+    pthread_mutexattr_destroy(&attr);
 }
 
 size_t bm_count_free(const BlockManager *bm) {
     if (!bm) return 0;
 
-    size_t free_count = 0;
-    for (int i = 0; i < FS_NUM_BLOCKS; ++i) {
-        if (!bm->block_used[i]) {
-            ++free_count;
+    size_t claimed = atomic_load_explicit(&bm->claimed, memory_order_relaxed);
+    return claimed < FS_NUM_BLOCKS ? (size_t)FS_NUM_BLOCKS - claimed : 0;
+}
+
+int bm_is_used(const BlockManager *bm, int block) {
+    if (!bm || block < 0 || block >= FS_NUM_BLOCKS) return 0;
+
+    const AllocGroup *grp = &bm->groups[block / FS_BLOCKS_PER_GROUP];
+    if (block % FS_BLOCKS_PER_GROUP >= grp->high_water) return 0;
+    return bm->block_used[block] != 0;
+}
+
+void bm_set_used(BlockManager *bm, int block, int used) {
+    if (!bm || block < 0 || block >= FS_NUM_BLOCKS) return;
+
+    AllocGroup *grp = &bm->groups[block / FS_BLOCKS_PER_GROUP];
+    int first = block - block % FS_BLOCKS_PER_GROUP;
+    int rel = block - first;
+
+    if (rel >= grp->high_water) {
+        if (!used) return;
+        /* Bits between the old mark and this block were never valid */
+        for (int i = first + grp->high_water; i < block; ++i) {
+            bm->block_used[i] = 0;
         }
+        grp->high_water = rel + 1;
     }
-    return free_count;
+    bm->block_used[block] = used ? 1 : 0;
 }
 
-int bm_allocate(BlockManager *bm, size_t count, int *out_blocks) {
-    if (!bm || !out_blocks) return FS_ERR_INVALID_ARGUMENT;
-    if (count == 0) return FS_OK;
+static void recount_group(BlockManager *bm, int g) {
+    int first = g * FS_BLOCKS_PER_GROUP;
+    size_t used_count = 0;
+    for (int i = first; i < first + bm->groups[g].high_water; ++i) {
+        if (bm->block_used[i]) ++used_count;
+    }
+    atomic_store(&bm->groups[g].used_count, used_count);
+}
+
+void bm_recount(BlockManager *bm) {
+    if (!bm) return;
 
-    size_t free_count = bm_count_free(bm);
-    if (free_count < count) {
-        return FS_ERR_NO_SPACE;
+    size_t claimed = 0;
+    for (int g = 0; g < FS_ALLOC_GROUPS; ++g) {
+        recount_group(bm, g);
+        claimed += atomic_load(&bm->groups[g].used_count);
+    }
+    atomic_store(&bm->claimed, claimed);
+}
+
+static void group_lock(BlockManager *bm, int g) {
+    if (pthread_mutex_lock(&bm->groups[g].lock) == EOWNERDEAD) {
+        /* Previous holder died mid-allocation; its bits may be set without
+         * the counter following, so bring the counter back in line. The
+         * blocks it took, and the rest of its reservation, stay lost until
+         * fsck frees them and recounts. */
+        recount_group(bm, g);
+        pthread_mutex_consistent(&bm->groups[g].lock);
+    }
+}
+
+void bm_reset(BlockManager *bm) {
+    if (!bm) return;
+
+    for (int g = 0; g < FS_ALLOC_GROUPS; ++g) {
+        group_lock(bm, g);
+        bm->groups[g].high_water = 0;
+        atomic_store(&bm->groups[g].used_count, 0);
+        pthread_mutex_unlock(&bm->groups[g].lock);
+    }
+    atomic_store(&bm->claimed, 0);
+}
+
+int bm_preferred_group(BlockManager *bm) {
+    if (t_group < 0) {
+        t_group = (int)(atomic_fetch_add(&bm->next_group, 1) % FS_ALLOC_GROUPS);
+    }
+    return t_group;
+}
+
+/* Takes up to 'count' free blocks from group g; returns how many it got */
+static size_t allocate_in_group(BlockManager *bm, int g,
+                                size_t count, int *out_blocks) {
+    AllocGroup *grp = &bm->groups[g];
+    if (atomic_load_explicit(&grp->used_count, memory_order_relaxed)
+            == FS_BLOCKS_PER_GROUP) {
+        return 0;
     }
 
     size_t assigned = 0;
-    for (int i = 0; i < FS_NUM_BLOCKS && assigned < count; ++i) {
+    int first = g * FS_BLOCKS_PER_GROUP;
+
+    group_lock(bm, g);
+    /* Reuse freed blocks first, then extend into never-used ones */
+    for (int i = first; i < first + grp->high_water && assigned < count; ++i) {
         if (!bm->block_used[i]) {
             bm->block_used[i] = 1;
             out_blocks[assigned++] = i;
         }
     }
+    while (assigned < count && grp->high_water < FS_BLOCKS_PER_GROUP) {
+        int i = first + grp->high_water++;
+        bm->block_used[i] = 1;
+        out_blocks[assigned++] = i;
+    }
+    atomic_fetch_add(&grp->used_count, assigned);
+    pthread_mutex_unlock(&grp->lock);
+
+    return assigned;
+}
+
+int bm_allocate(BlockManager *bm, size_t count, int *out_blocks) {
+    if (!bm || !out_blocks) return FS_ERR_INVALID_ARGUMENT;
+    if (count == 0) return FS_OK;
+
+    /* Reserve the space up front, so two callers that each fit cannot
+     * both take part of it and then both give up */
+    size_t claimed = atomic_load(&bm->claimed);
+    do {
+        if (claimed > FS_NUM_BLOCKS || FS_NUM_BLOCKS - claimed < count) {
+            return FS_ERR_NO_SPACE;
+        }
+    } while (!atomic_compare_exchange_weak(&bm->claimed, &claimed,
+                                           claimed + count));
+
+    /* The reserved blocks are free somewhere. A pass can still come up
+     * short when a block is freed into a group already visited, so go
+     * around again until the reservation is filled. */
+    int preferred = bm_preferred_group(bm);
+    size_t assigned = 0;
+    for (int k = 0; assigned < count; ++k) {
+        int g = (preferred + k) % FS_ALLOC_GROUPS;
+        assigned += allocate_in_group(bm, g, count - assigned,
+                                      out_blocks + assigned);
+    }
 
     return FS_OK;
 }
@@ -42,10 +172,34 @@ int bm_allocate(BlockManager *bm, size_t count, int *out_blocks) {
 void bm_free(BlockManager *bm, const int *blocks, size_t count) {
     if (!bm || !blocks) return;
 
-    for (size_t i = 0; i < count; ++i) {
+    size_t i = 0;
+    while (i < count) {
         int idx = blocks[i];
-        if (idx >= 0 && idx < FS_NUM_BLOCKS) {
-            bm->block_used[idx] = 0;
+        if (idx < 0 || idx >= FS_NUM_BLOCKS) {
+            ++i;
+            continue;
+        }
+
+        /* Free the whole run of blocks that falls in this group at once */
+        int g = idx / FS_BLOCKS_PER_GROUP;
+        AllocGroup *grp = &bm->groups[g];
+        size_t released = 0;
+
+        group_lock(bm, g);
+        int end = g * FS_BLOCKS_PER_GROUP + grp->high_water;
+        for (; i < count; ++i) {
+            idx = blocks[i];
+            if (idx < 0 || idx >= FS_NUM_BLOCKS) continue;
+            if (idx / FS_BLOCKS_PER_GROUP != g) break;
+            if (idx < end && bm->block_used[idx]) {
+                bm->block_used[idx] = 0;
+                ++released;
+            }
         }
+        atomic_fetch_sub(&grp->used_count, released);
+        pthread_mutex_unlock(&grp->lock);
+
+        /* Only after the bits are clear, so claims stay backed by blocks */
+        atomic_fetch_sub(&bm->claimed, released);
     }
 }
@@ -1,19 +1,71 @@
 #ifndef BLOCK_MANAGER_H
 #define BLOCK_MANAGER_H
 
+#include <pthread.h>
+#include <stdatomic.h>
+
 #include "filesystem.h"
 
+/* The block map is split into allocation groups, each with its own lock and
+ * free counter, so threads allocating in different groups never contend */
+#define FS_ALLOC_GROUPS        8
+#define FS_BLOCKS_PER_GROUP    (FS_NUM_BLOCKS / FS_ALLOC_GROUPS)
+
+#if FS_NUM_BLOCKS % FS_ALLOC_GROUPS != 0
+#error "FS_NUM_BLOCKS must be a multiple of FS_ALLOC_GROUPS"
+#endif
+
+#define FS_CACHE_LINE          64
+
+/* One slice of the block map. Blocks at or past high_water have never been
+ * handed out and are free whatever their bits say, so a new map needs no
+ * clearing and an all-zero group is an empty one. Each group starts on its
+ * own cache line so its lock and counter never share one with a neighbour. */
+typedef struct {
+    _Alignas(FS_CACHE_LINE)
+    pthread_mutex_t lock;                       /* Guards this group's bits */
+    atomic_size_t   used_count;                 /* Used blocks in the group */
+    int             high_water;                 /* Blocks ever handed out   */
+} AllocGroup;
+
+/* next_group lives in the volume, not in each process, so single-threaded
+ * workers sharing a volume still start in different groups. 'claimed'
+ * counts used blocks plus those reserved by allocations still picking
+ * them, so a reservation that succeeds is always backed by free blocks. */
 typedef struct {
-    int block_used[FS_NUM_BLOCKS];
+    AllocGroup    groups[FS_ALLOC_GROUPS];
+    atomic_uint   next_group;           /* Next group handed to a thread */
+    atomic_size_t claimed;              /* Used or reserved blocks       */
+    int           block_used[FS_NUM_BLOCKS];
 } BlockManager;
 
-/* Starts the Block Manager */
-void   bm_init(BlockManager *bm);
+/* Starts the Block Manager in constant time (the bitmap is not touched);
+ * 'shared' makes its locks usable across processes */
+void   bm_init(BlockManager *bm, int shared);
 
-/* Counts free blocks */
+/* Frees every block in constant time, leaving the locks alone; for
+ * re-formatting a volume other processes may be using */
+void   bm_reset(BlockManager *bm);
+
+/* Counts free blocks that no allocation has reserved (no locking) */
 size_t bm_count_free(const BlockManager *bm);
 
-/* Allocates 'count' blocks and places the indices in out_blocks */
+/* Returns 1 if a block is allocated */
+int    bm_is_used(const BlockManager *bm, int block);
+
+/* Marks a block used or free without touching the counters; for fsck */
+void   bm_set_used(BlockManager *bm, int block, int used);
+
+/* Recomputes every counter from the bitmap; for fsck, with no allocation
+ * in flight */
+void   bm_recount(BlockManager *bm);
+
+/* Allocation group preferred by the calling thread */
+int    bm_preferred_group(BlockManager *bm);
+
+/* Allocates 'count' blocks and places the indices in out_blocks.
+ * Reserves the space first, then starts in the caller's preferred group
+ * and steals from the others when it fills up; all or nothing. */
 int    bm_allocate(BlockManager *bm, size_t count, int *out_blocks);
 
 /* Frees 'count' blocks that are in the blocks[] array */
@@ -4,22 +4,13 @@
 
 void dir_init(Directory *dir) {
     if (!dir) return;
-
-    for (int i = 0; i < FS_MAX_FILES; ++i) {
-        dir->entries[i].used = 0;
-        dir->entries[i].name[0] = '\0';
-        dir->entries[i].size = 0;
-        dir->entries[i].block_count = 0;
-        for (int j = 0; j < FS_MAX_BLOCKS_PER_FILE; ++j) {
-            dir->entries[i].blocks[j] = -1;
-        }
-    }
+    dir->high_water = 0;
 }
 
 int dir_find(const Directory *dir, const char *name) {
     if (!dir || !name) return -1;
 
-    for (int i = 0; i < FS_MAX_FILES; ++i) {
+    for (int i = 0; i < dir->high_water; ++i) {
         if (dir->entries[i].used &&
             strncmp(dir->entries[i].name, name, FS_MAX_FILENAME) == 0) {
             return i;
@@ -41,13 +32,17 @@ int dir_add(Directory *dir, const char *name, size_t size, int *out_index) {
         return FS_ERR_FILE_EXISTS;
     }
 
+    /* Reuse a freed slot, else take the first never-initialized one */
     int free_index = -1;
-    for (int i = 0; i < FS_MAX_FILES; ++i) {
+    for (int i = 0; i < dir->high_water; ++i) {
         if (!dir->entries[i].used) {
             free_index = i;
             break;
         }
     }
+    if (free_index == -1 && dir->high_water < FS_MAX_FILES) {
+        free_index = dir->high_water++;
+    }
 
     if (free_index == -1) {
         return FS_ERR_NO_SPACE; /* No space in the directory */
@@ -59,9 +54,6 @@ int dir_add(Directory *dir, const char *name, size_t size, int *out_index) {
     e->name[FS_MAX_FILENAME - 1] = '\0';
     e->size = size;
     e->block_count = 0;
-    for (int j = 0; j < FS_MAX_BLOCKS_PER_FILE; ++j) {
-        e->blocks[j] = -1;
-    }
 
     if (out_index) {
         *out_index = free_index;
@@ -83,16 +75,13 @@ int dir_remove(Directory *dir, const char *name) {
     e->name[0] = '\0';
     e->size = 0;
     e->block_count = 0;
-    for (int j = 0; j < FS_MAX_BLOCKS_PER_FILE; ++j) {
-        e->blocks[j] = -1;
-    }
 
     return FS_OK;
 }
 
 FileEntry *dir_get(Directory *dir, int index) {
     if (!dir) return NULL;
-    if (index < 0 || index >= FS_MAX_FILES) return NULL;
+    if (index < 0 || index >= dir->high_water) return NULL;
     if (!dir->entries[index].used) return NULL;
     return &dir->entries[index];
 }
@@ -101,7 +90,7 @@ void dir_list(const Directory *dir) {
     if (!dir) return;
 
     int any = 0;
-    for (int i = 0; i < FS_MAX_FILES; ++i) {
+    for (int i = 0; i < dir->high_water; ++i) {
         if (dir->entries[i].used) {
             printf("%s - %zu bytes\n",
                    dir->entries[i].name,
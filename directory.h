@@ -12,12 +12,14 @@ typedef struct {
     int    blocks[FS_MAX_BLOCKS_PER_FILE];      /* Block indices         */
 } FileEntry;
 
-/* Complete root directory */
+/* Complete root directory. Slots at or past high_water have never been
+ * initialized and count as free, so an empty directory touches no entry. */
 typedef struct {
+    int       high_water;                       /* Slots ever handed out */
     FileEntry entries[FS_MAX_FILES];
 } Directory;
 
-/* Initializes the directory (no files) */
+/* Initializes the directory (no files) in constant time */
 void      dir_init(Directory *dir);
 
 /* Finds a file by name; returns index or -1 if not found */
@@ -2,17 +2,37 @@
 
 static size_t blocks_for_size(size_t size) {
     if (size == 0) return 0;
-    return (size + FS_BLOCK_SIZE - 1) / FS_BLOCK_SIZE;
+    return (size + FS_BLOCK_MASK) >> FS_BLOCK_SHIFT;
 }
 
-int file_create(Directory *dir,
-                BlockManager *bm,
-                Storage *st,
-                const char *name,
-                size_t size) {
-    (void)st; 
+int file_alloc_blocks(BlockManager *bm,
+                      size_t size,
+                      int *out_blocks,
+                      size_t *out_count) {
+    if (out_count) *out_count = 0;
 
-    if (!dir || !bm || !name) return FS_ERR_INVALID_ARGUMENT;
+    if (!bm || !out_blocks || !out_count) return FS_ERR_INVALID_ARGUMENT;
+
+    size_t required_blocks = blocks_for_size(size);
+    if (required_blocks > FS_MAX_BLOCKS_PER_FILE) {
+        return FS_ERR_NO_SPACE;
+    }
+
+    int rc = bm_allocate(bm, required_blocks, out_blocks);
+    if (rc != FS_OK) {
+        return rc;
+    }
+
+    *out_count = required_blocks;
+    return FS_OK;
+}
+
+int file_attach_blocks(Directory *dir,
+                       const char *name,
+                       size_t size,
+                       const int *blocks,
+                       size_t count) {
+    if (!dir || !name || (count > 0 && !blocks)) return FS_ERR_INVALID_ARGUMENT;
 
     int entry_index = -1;
     int rc = dir_add(dir, name, size, &entry_index);
@@ -25,133 +45,222 @@ int file_create(Directory *dir,
         return FS_ERR_INVALID_ARGUMENT;
     }
 
-    size_t required_blocks = blocks_for_size(size);
-    if (required_blocks == 0) {
-        e->block_count = 0;
-        return FS_OK;
+    for (size_t i = 0; i < count; ++i) {
+        e->blocks[i] = blocks[i];
     }
+    e->block_count = (int)count;
+    return FS_OK;
+}
 
-    rc = bm_allocate(bm, required_blocks, e->blocks);
-    if (rc != FS_OK) {
-        /* revert entry in case of error */
-        dir_remove(dir, name);
-        return rc;
+/* Checks that [offset, offset + total) lies inside the file */
+static int check_range(const FileEntry *f, size_t offset, size_t total) {
+    if (offset > f->size) {
+        return FS_ERR_INVALID_OFFSET;
+    }
+    if (total > f->size - offset) {
+        return FS_ERR_OUT_OF_BOUNDS;
     }
-
-    e->block_count = (int)required_blocks;
     return FS_OK;
 }
 
-int file_write(Directory *dir,
-               BlockManager *bm,
-               Storage *st,
-               const char *name,
-               size_t offset,
-               const char *data,
-               size_t data_len,
-               size_t *bytes_written) {
-    (void)bm; 
-
-    if (bytes_written) *bytes_written = 0;
-
-    if (!dir || !st || !name || !data) return FS_ERR_INVALID_ARGUMENT;
-
+/* Resolves 'name' and checks that [offset, offset + total) lies inside it */
+static int resolve_range(Directory *dir,
+                         const char *name,
+                         size_t offset,
+                         size_t total,
+                         FileEntry **out_file) {
     int idx = dir_find(dir, name);
     if (idx == -1) return FS_ERR_FILE_NOT_FOUND;
 
     FileEntry *f = dir_get(dir, idx);
     if (!f) return FS_ERR_FILE_NOT_FOUND;
 
-    if (offset > f->size) {
-        return FS_ERR_INVALID_OFFSET;
-    }
-    if (data_len == 0) {
-        return FS_OK;
-    }
-    if (offset + data_len > f->size) {
-        return FS_ERR_OUT_OF_BOUNDS;
-    }
+    int rc = check_range(f, offset, total);
+    if (rc != FS_OK) return rc;
 
-    for (size_t i = 0; i < data_len; ++i) {
-        size_t pos = offset + i;
-        size_t block_index = pos / FS_BLOCK_SIZE;
-        size_t block_offset = pos % FS_BLOCK_SIZE;
+    *out_file = f;
+    return FS_OK;
+}
 
-        if ((int)block_index >= f->block_count) {
-            return FS_ERR_OUT_OF_BOUNDS;
-        }
+/* Sums the buffer lengths; fails on a NULL buffer or overflow */
+static int iov_total(const FsIovec *iov, int iovcnt, size_t *out_total) {
+    if (iovcnt < 0 || (iovcnt > 0 && !iov)) return FS_ERR_INVALID_ARGUMENT;
 
-        int disk_block = f->blocks[block_index];
-        int rc = storage_write_byte(st, disk_block, block_offset,
-                                    (unsigned char)data[i]);
-        if (rc != FS_OK) {
-            return rc;
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        if (!iov[i].base && iov[i].len > 0) return FS_ERR_INVALID_ARGUMENT;
+        if (iov[i].len > (size_t)-1 - total) return FS_ERR_OUT_OF_BOUNDS;
+        total += iov[i].len;
+    }
+
+    *out_total = total;
+    return FS_OK;
+}
+
+/* Walks the block mapping once from 'offset', moving one block-sized span
+ * at a time between Storage and the buffers */
+static int copy_spans(FileEntry *f,
+                      Storage *st,
+                      size_t offset,
+                      const FsIovec *iov,
+                      int iovcnt,
+                      int to_storage) {
+    size_t block_index = offset >> FS_BLOCK_SHIFT;
+    size_t block_offset = offset & FS_BLOCK_MASK;
+
+    for (int i = 0; i < iovcnt; ++i) {
+        char  *buf = (char *)iov[i].base;
+        size_t left = iov[i].len;
+
+        while (left > 0) {
+            if ((int)block_index >= f->block_count) {
+                return FS_ERR_OUT_OF_BOUNDS;
+            }
+
+            size_t span = FS_BLOCK_SIZE - block_offset;
+            if (span > left) span = left;
+
+            int disk_block = f->blocks[block_index];
+            int rc = to_storage
+                ? storage_write(st, disk_block, block_offset, buf, span)
+                : storage_read(st, disk_block, block_offset, buf, span);
+            if (rc != FS_OK) {
+                return rc;
+            }
+
+            buf += span;
+            left -= span;
+            block_offset += span;
+            if (block_offset == FS_BLOCK_SIZE) {
+                ++block_index;
+                block_offset = 0;
+            }
         }
     }
+    return FS_OK;
+}
+
+int file_writev(Directory *dir,
+                Storage *st,
+                const char *name,
+                size_t offset,
+                const FsIovec *iov,
+                int iovcnt,
+                size_t *bytes_written) {
+    if (bytes_written) *bytes_written = 0;
+
+    if (!dir || !st || !name) return FS_ERR_INVALID_ARGUMENT;
+
+    size_t total = 0;
+    int rc = iov_total(iov, iovcnt, &total);
+    if (rc != FS_OK) return rc;
+
+    FileEntry *f = NULL;
+    rc = resolve_range(dir, name, offset, total, &f);
+    if (rc != FS_OK || total == 0) return rc;
+
+    rc = copy_spans(f, st, offset, iov, iovcnt, 1);
+    if (rc != FS_OK) return rc;
 
     if (bytes_written) {
-        *bytes_written = data_len;
+        *bytes_written = total;
     }
-
     return FS_OK;
 }
 
-int file_read(Directory *dir,
-              Storage *st,
-              const char *name,
-              size_t offset,
-              size_t size,
-              char *out_buffer,
-              size_t *out_bytes_read) {
+int file_readv(Directory *dir,
+               Storage *st,
+               const char *name,
+               size_t offset,
+               const FsIovec *iov,
+               int iovcnt,
+               size_t *out_bytes_read) {
     if (out_bytes_read) *out_bytes_read = 0;
 
-    if (!dir || !st || !name || !out_buffer) return FS_ERR_INVALID_ARGUMENT;
+    if (!dir || !st || !name) return FS_ERR_INVALID_ARGUMENT;
 
-    int idx = dir_find(dir, name);
-    if (idx == -1) return FS_ERR_FILE_NOT_FOUND;
+    size_t total = 0;
+    int rc = iov_total(iov, iovcnt, &total);
+    if (rc != FS_OK) return rc;
 
-    FileEntry *f = dir_get(dir, idx);
-    if (!f) return FS_ERR_FILE_NOT_FOUND;
+    FileEntry *f = NULL;
+    rc = resolve_range(dir, name, offset, total, &f);
+    if (rc != FS_OK || total == 0) return rc;
 
-    if (offset > f->size) {
-        return FS_ERR_INVALID_OFFSET;
-    }
-    if (size == 0) {
-        return FS_OK;
-    }
-    if (offset + size > f->size) {
-        return FS_ERR_OUT_OF_BOUNDS;
+    rc = copy_spans(f, st, offset, iov, iovcnt, 0);
+    if (rc != FS_OK) return rc;
+
+    if (out_bytes_read) {
+        *out_bytes_read = total;
     }
+    return FS_OK;
+}
 
-    for (size_t i = 0; i < size; ++i) {
-        size_t pos = offset + i;
-        size_t block_index = pos / FS_BLOCK_SIZE;
-        size_t block_offset = pos % FS_BLOCK_SIZE;
+int file_read_entry(FileEntry *f,
+                    Storage *st,
+                    size_t offset,
+                    size_t size,
+                    char *out_buffer,
+                    size_t *out_bytes_read) {
+    if (out_bytes_read) *out_bytes_read = 0;
 
-        if ((int)block_index >= f->block_count) {
-            return FS_ERR_OUT_OF_BOUNDS;
-        }
+    if (!f || !st || !out_buffer) return FS_ERR_INVALID_ARGUMENT;
 
-        int disk_block = f->blocks[block_index];
-        unsigned char value = 0;
-        int rc = storage_read_byte(st, disk_block, block_offset, &value);
-        if (rc != FS_OK) {
-            return rc;
-        }
-        out_buffer[i] = (char)value;
-    }
+    int rc = check_range(f, offset, size);
+    if (rc != FS_OK || size == 0) return rc;
+
+    FsIovec iov = { out_buffer, size };
+    rc = copy_spans(f, st, offset, &iov, 1, 0);
+    if (rc != FS_OK) return rc;
 
     if (out_bytes_read) {
         *out_bytes_read = size;
     }
-
     return FS_OK;
 }
 
-int file_delete(Directory *dir,
-                BlockManager *bm,
-                const char *name) {
-    if (!dir || !bm || !name) return FS_ERR_INVALID_ARGUMENT;
+int file_write(Directory *dir,
+               BlockManager *bm,
+               Storage *st,
+               const char *name,
+               size_t offset,
+               const char *data,
+               size_t data_len,
+               size_t *bytes_written) {
+    (void)bm; 
+
+    if (bytes_written) *bytes_written = 0;
+
+    if (!data) return FS_ERR_INVALID_ARGUMENT;
+
+    FsIovec iov = { (void *)data, data_len };
+    return file_writev(dir, st, name, offset, &iov, 1, bytes_written);
+}
+
+int file_read(Directory *dir,
+              Storage *st,
+              const char *name,
+              size_t offset,
+              size_t size,
+              char *out_buffer,
+              size_t *out_bytes_read) {
+    if (out_bytes_read) *out_bytes_read = 0;
+
+    if (!out_buffer) return FS_ERR_INVALID_ARGUMENT;
+
+    FsIovec iov = { out_buffer, size };
+    return file_readv(dir, st, name, offset, &iov, 1, out_bytes_read);
+}
+
+int file_detach_blocks(Directory *dir,
+                       const char *name,
+                       int *out_blocks,
+                       size_t *out_count) {
+    if (out_count) *out_count = 0;
+
+    if (!dir || !name || !out_blocks || !out_count) {
+        return FS_ERR_INVALID_ARGUMENT;
+    }
 
     int idx = dir_find(dir, name);
     if (idx == -1) {
@@ -163,9 +272,10 @@ int file_delete(Directory *dir,
         return FS_ERR_FILE_NOT_FOUND;
     }
 
-    if (f->block_count > 0) {
-        bm_free(bm, f->blocks, (size_t)f->block_count);
+    for (int i = 0; i < f->block_count; ++i) {
+        out_blocks[i] = f->blocks[i];
     }
+    *out_count = (size_t)f->block_count;
 
     return dir_remove(dir, name);
 }
@@ -6,12 +6,18 @@
 #include "block_manager.h"
 #include "storage.h"
 
-/* Creates a file in the directory using the block manager */
-int file_create(Directory *dir,
-                BlockManager *bm,
-                Storage *st,          /* st is here for symmetry; not used much */
-                const char *name,
-                size_t size);
+/* Allocates the blocks a file of 'size' bytes needs (no directory change) */
+int file_alloc_blocks(BlockManager *bm,
+                      size_t size,
+                      int *out_blocks,
+                      size_t *out_count);
+
+/* Adds a directory entry that takes ownership of already allocated blocks */
+int file_attach_blocks(Directory *dir,
+                       const char *name,
+                       size_t size,
+                       const int *blocks,
+                       size_t count);
 
 /* Writes data_len bytes starting at offset in a file */
 int file_write(Directory *dir,
@@ -32,9 +38,37 @@ int file_read(Directory *dir,
               char *out_buffer,
               size_t *out_bytes_read);
 
-/* Deletes a file */
-int file_delete(Directory *dir,
-                BlockManager *bm,
-                const char *name);
+/* Removes a directory entry and hands its blocks back to the caller,
+ * who must free them with bm_free */
+int file_detach_blocks(Directory *dir,
+                       const char *name,
+                       int *out_blocks,
+                       size_t *out_count);
+
+/* Writes the buffers of iov[] back to back starting at offset */
+int file_writev(Directory *dir,
+                Storage *st,
+                const char *name,
+                size_t offset,
+                const FsIovec *iov,
+                int iovcnt,
+                size_t *bytes_written);
+
+/* Fills the buffers of iov[] back to back from offset */
+int file_readv(Directory *dir,
+               Storage *st,
+               const char *name,
+               size_t offset,
+               const FsIovec *iov,
+               int iovcnt,
+               size_t *out_bytes_read);
+
+/* Reads from an entry the caller already resolved */
+int file_read_entry(FileEntry *f,
+                    Storage *st,
+                    size_t offset,
+                    size_t size,
+                    char *out_buffer,
+                    size_t *out_bytes_read);
 
 #endif
@@ -1,26 +1,108 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "filesystem.h"
 #include "storage.h"
 #include "block_manager.h"
 #include "directory.h"
 #include "file_operations.h"
+#include "volume.h"
+#include "fsck.h"
+#include "trace.h"
+#include "readahead.h"
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Global structures: a private volume, or one mapped from shared memory */
+static Volume *g_local_volume = NULL;
+static Volume *g_vol = NULL;
+static char    g_owned_name[FS_MAX_FILENAME];  /* Set if we created g_vol */
 
-/* Global structures */
-static Storage      g_storage;
-static BlockManager g_block_manager;
-static Directory    g_directory;
+static void fs_lock(void) {
+    if (pthread_mutex_lock(&g_vol->lock) == EOWNERDEAD) {
+        /* Previous holder died mid-operation; take over the lock */
+        pthread_mutex_consistent(&g_vol->lock);
+    }
+}
+
+static void fs_unlock(void) {
+    pthread_mutex_unlock(&g_vol->lock);
+}
 
 void fs_init(void) {
-    storage_init(&g_storage);
-    bm_init(&g_block_manager);
-    dir_init(&g_directory);
+    if (g_vol && g_vol != g_local_volume) {
+        /* Empty the mounted shared volume in place. Other processes may
+         * hold or wait on its locks, so those stay as they are; only the
+         * directory and block map are reset, with every caller kept out. */
+        volume_gate_close(g_vol);
+        fs_lock();
+        dir_init(&g_vol->dir);
+        bm_reset(&g_vol->bm);
+        fs_unlock();
+        volume_gate_open(g_vol);
+        return;
+    }
+
+    /* A fresh zero-filled mapping costs the same whatever the volume size,
+     * unlike clearing the old one */
+    volume_destroy_private(g_local_volume);
+    g_local_volume = volume_create_private();
+    if (!g_local_volume) {
+        fprintf(stderr, "Fatal: could not map the filesystem volume.\n");
+        abort();
+    }
+    g_vol = g_local_volume;
 }
 
-/* API's that delegate to file_operations */
+/* Total length of a buffer list, for trace records */
+static size_t iov_bytes(const FsIovec *iov, int iovcnt) {
+    size_t total = 0;
+    for (int i = 0; iov && i < iovcnt; ++i) {
+        total += iov[i].len;
+    }
+    return total;
+}
+
+/* API's that delegate to file_operations. Each one reports itself to the
+ * trace recorder, which costs one relaxed load while no trace runs. */
+
+static int create_file(const char *name, size_t size) {
+    if (!name) return FS_ERR_INVALID_ARGUMENT;
+
+    size_t len = strlen(name);
+    if (len == 0 || len >= FS_MAX_FILENAME) {
+        return FS_ERR_INVALID_ARGUMENT;
+    }
+
+    /* Blocks come from the per-group allocator, outside the volume lock,
+     * so creates from different threads only meet on the directory */
+    int    blocks[FS_MAX_BLOCKS_PER_FILE];
+    size_t count = 0;
+    int slot = volume_gate_enter(g_vol);
+    int rc = file_alloc_blocks(&g_vol->bm, size, blocks, &count);
+
+    fs_lock();
+    if (rc == FS_OK) {
+        rc = file_attach_blocks(&g_vol->dir, name, size, blocks, count);
+    } else if (dir_find(&g_vol->dir, name) != -1) {
+        rc = FS_ERR_FILE_EXISTS;
+    }
+    fs_unlock();
+
+    if (rc != FS_OK && count > 0) {
+        bm_free(&g_vol->bm, blocks, count);
+    }
+    volume_gate_leave(g_vol, slot);
+    return rc;
+}
 
 int fs_create(const char *name, size_t size) {
-    return file_create(&g_directory, &g_block_manager, &g_storage, name, size);
+    uint64_t t = trace_begin();
+    int rc = create_file(name, size);
+    trace_end(t, TRACE_OP_CREATE, name, 0, size, NULL, 0, rc);
+    return rc;
 }
 
 int fs_write(const char *name,
@@ -28,14 +110,21 @@ int fs_write(const char *name,
              const char *data,
              size_t data_len,
              size_t *bytes_written) {
-    return file_write(&g_directory,
-                      &g_block_manager,
-                      &g_storage,
-                      name,
-                      offset,
-                      data,
-                      data_len,
-                      bytes_written);
+    uint64_t t = trace_begin();
+    fs_lock();
+    int rc = file_write(&g_vol->dir,
+                        &g_vol->bm,
+                        &g_vol->storage,
+                        name,
+                        offset,
+                        data,
+                        data_len,
+                        bytes_written);
+    fs_unlock();
+
+    FsIovec iov = { (void *)data, data_len };
+    trace_end(t, TRACE_OP_WRITE, name, offset, data_len, &iov, 1, rc);
+    return rc;
 }
 
 int fs_read(const char *name,
@@ -43,24 +132,195 @@ int fs_read(const char *name,
             size_t size,
             char *out_buffer,
             size_t *out_bytes_read) {
-    return file_read(&g_directory,
-                     &g_storage,
-                     name,
-                     offset,
-                     size,
-                     out_buffer,
-                     out_bytes_read);
+    uint64_t t = trace_begin();
+    if (out_bytes_read) *out_bytes_read = 0;
+
+    int rc = FS_ERR_INVALID_ARGUMENT;
+
+    if (name && out_buffer) {
+        /* A stream that keeps reading one file skips the directory scan */
+        ReadStream *rs = ra_stream(name);
+
+        fs_lock();
+        FileEntry *f = ra_lookup(rs, &g_vol->dir, name);
+        rc = f ? file_read_entry(f, &g_vol->storage, offset, size,
+                                 out_buffer, out_bytes_read)
+               : FS_ERR_FILE_NOT_FOUND;
+        fs_unlock();
+    }
+
+    trace_end(t, TRACE_OP_READ, name, offset, size, NULL, 0, rc);
+    return rc;
+}
+
+int fs_writev(const char *name,
+              size_t offset,
+              const FsIovec *iov,
+              int iovcnt,
+              size_t *bytes_written) {
+    uint64_t t = trace_begin();
+    fs_lock();
+    int rc = file_writev(&g_vol->dir,
+                         &g_vol->storage,
+                         name,
+                         offset,
+                         iov,
+                         iovcnt,
+                         bytes_written);
+    fs_unlock();
+    trace_end(t, TRACE_OP_WRITEV, name, offset, iov_bytes(iov, iovcnt),
+              iov, iovcnt, rc);
+    return rc;
+}
+
+int fs_readv(const char *name,
+             size_t offset,
+             const FsIovec *iov,
+             int iovcnt,
+             size_t *out_bytes_read) {
+    uint64_t t = trace_begin();
+    fs_lock();
+    int rc = file_readv(&g_vol->dir,
+                        &g_vol->storage,
+                        name,
+                        offset,
+                        iov,
+                        iovcnt,
+                        out_bytes_read);
+    fs_unlock();
+    trace_end(t, TRACE_OP_READV, name, offset, iov_bytes(iov, iovcnt),
+              iov, iovcnt, rc);
+    return rc;
+}
+
+static int delete_file(const char *name) {
+    int    blocks[FS_MAX_BLOCKS_PER_FILE];
+    size_t count = 0;
+
+    int slot = volume_gate_enter(g_vol);
+    fs_lock();
+    int rc = file_detach_blocks(&g_vol->dir, name, blocks, &count);
+    fs_unlock();
+
+    if (rc == FS_OK && count > 0) {
+        bm_free(&g_vol->bm, blocks, count);
+    }
+    volume_gate_leave(g_vol, slot);
+    return rc;
 }
 
 int fs_delete(const char *name) {
-    return file_delete(&g_directory, &g_block_manager, name);
+    uint64_t t = trace_begin();
+    int rc = delete_file(name);
+    trace_end(t, TRACE_OP_DELETE, name, 0, 0, NULL, 0, rc);
+    return rc;
 }
 
 void fs_list(void) {
-    dir_list(&g_directory);
+    uint64_t t = trace_begin();
+    fs_lock();
+    dir_list(&g_vol->dir);
+    fs_unlock();
+    trace_end(t, TRACE_OP_LIST, NULL, 0, 0, NULL, 0, FS_OK);
 }
 
 size_t fs_get_free_space(void) {
-    size_t free_blocks = bm_count_free(&g_block_manager);
-    return free_blocks * (size_t)FS_BLOCK_SIZE;
+    uint64_t t = trace_begin();
+    size_t free_blocks = bm_count_free(&g_vol->bm);
+    trace_end(t, TRACE_OP_FREE_SPACE, NULL, 0, free_blocks << FS_BLOCK_SHIFT,
+              NULL, 0, FS_OK);
+    return free_blocks << FS_BLOCK_SHIFT;
+}
+
+int fs_stat(const char *name, size_t *out_size) {
+    if (!name || !out_size) return FS_ERR_INVALID_ARGUMENT;
+
+    uint64_t t = trace_begin();
+    fs_lock();
+    int idx = dir_find(&g_vol->dir, name);
+    if (idx != -1) {
+        *out_size = g_vol->dir.entries[idx].size;
+    }
+    fs_unlock();
+
+    int rc = idx == -1 ? FS_ERR_FILE_NOT_FOUND : FS_OK;
+    trace_end(t, TRACE_OP_STAT, name, 0, rc == FS_OK ? *out_size : 0,
+              NULL, 0, rc);
+    return rc;
+}
+
+int fs_list_names(char (*names)[FS_MAX_FILENAME],
+                  size_t max,
+                  size_t *out_count) {
+    if (!out_count || (max > 0 && !names)) return FS_ERR_INVALID_ARGUMENT;
+
+    size_t count = 0;
+    fs_lock();
+    for (int i = 0; i < g_vol->dir.high_water; ++i) {
+        const FileEntry *e = &g_vol->dir.entries[i];
+        if (!e->used) continue;
+        if (count < max) {
+            memcpy(names[count], e->name, FS_MAX_FILENAME);
+        }
+        ++count;
+    }
+    fs_unlock();
+
+    *out_count = count;
+    return FS_OK;
+}
+
+int fs_check(int repair, FsckReport *report) {
+    /* Wait until no live create/delete has blocks in flight; those of
+     * dead clients are left for the check to report as leaked */
+    volume_gate_close(g_vol);
+    fs_lock();
+    int rc = fsck_run(&g_vol->dir, &g_vol->bm, &g_vol->storage,
+                      repair, report);
+    fs_unlock();
+    volume_gate_open(g_vol);
+    return rc;
+}
+
+/* Shared-memory volumes */
+
+int fs_serve_shared(const char *name, int replace) {
+    if (!name || strlen(name) >= FS_MAX_FILENAME) {
+        return FS_ERR_INVALID_ARGUMENT;
+    }
+
+    Volume *vol = NULL;
+    int rc = volume_create_shared(name, replace, &vol);
+    if (rc != FS_OK) return rc;
+
+    fs_detach_shared();
+    g_vol = vol;
+    strcpy(g_owned_name, name);
+    return FS_OK;
+}
+
+int fs_attach_shared(const char *name) {
+    if (!name) return FS_ERR_INVALID_ARGUMENT;
+
+    Volume *vol = volume_attach_shared(name);
+    if (!vol) return FS_ERR_IO;
+
+    fs_detach_shared();
+    g_vol = vol;
+    return FS_OK;
+}
+
+void fs_detach_shared(void) {
+    if (g_vol == g_local_volume) return;
+
+    if (g_owned_name[0] != '\0') {
+        volume_unlink_shared(g_owned_name);
+        g_owned_name[0] = '\0';
+    }
+    volume_detach_shared(g_vol);
+    g_vol = g_local_volume;
+
+    if (!g_vol) {
+        fs_init();
+    }
 }
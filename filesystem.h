@@ -5,14 +5,26 @@
 
 /* --- Parameters of the filesystem --- */
 
+/* Geometry profile: blocks are 2^FS_BLOCK_SHIFT bytes, so block arithmetic
+ * is shifts and masks. Pick one at build time, e.g. 'make BLOCK_SHIFT=12'
+ * for 4 KB blocks or 16 for 64 KB. */
+#ifndef FS_BLOCK_SHIFT
+#define FS_BLOCK_SHIFT         9               /* 512-byte blocks */
+#endif
+
 #define FS_TOTAL_SIZE          (1024 * 1024)   /* 1 MB total storage */
-#define FS_BLOCK_SIZE          512             /* Block size in bytes */
+#define FS_BLOCK_SIZE          (1 << FS_BLOCK_SHIFT) /* Block size in bytes */
+#define FS_BLOCK_MASK          (FS_BLOCK_SIZE - 1)
 #define FS_MAX_FILES           100             /* Maximum number of files */
 #define FS_MAX_FILENAME        64              /* Maximum filename length */
 
-#define FS_NUM_BLOCKS          (FS_TOTAL_SIZE / FS_BLOCK_SIZE)
+#define FS_NUM_BLOCKS          (FS_TOTAL_SIZE >> FS_BLOCK_SHIFT)
 #define FS_MAX_BLOCKS_PER_FILE FS_NUM_BLOCKS
 
+#if FS_BLOCK_SHIFT < 6 || (FS_TOTAL_SIZE & FS_BLOCK_MASK) != 0
+#error "FS_BLOCK_SHIFT must give a block size that divides FS_TOTAL_SIZE"
+#endif
+
 /* --- Error codes --- */
 
 #define FS_OK                    0
@@ -22,10 +34,18 @@
 #define FS_ERR_INVALID_OFFSET   -4
 #define FS_ERR_OUT_OF_BOUNDS    -5
 #define FS_ERR_INVALID_ARGUMENT -6
+#define FS_ERR_IO               -7
+
+/* One buffer of a vectored read or write */
+typedef struct {
+    void  *base;
+    size_t len;
+} FsIovec;
 
 /* API */
 
-/* Initializes the filesystem */
+/* Initializes the filesystem; on a mounted shared volume it empties the
+ * volume in place for every process attached to it */
 void   fs_init(void);
 
 /* Creates a file */
@@ -45,6 +65,20 @@ int    fs_read(const char *name,
                char *out_buffer,
                size_t *out_bytes_read);
 
+/* Writes several buffers back to back, resolving the file only once */
+int    fs_writev(const char *name,
+                 size_t offset,
+                 const FsIovec *iov,
+                 int iovcnt,
+                 size_t *bytes_written);
+
+/* Reads into several buffers back to back, resolving the file only once */
+int    fs_readv(const char *name,
+                size_t offset,
+                const FsIovec *iov,
+                int iovcnt,
+                size_t *out_bytes_read);
+
 /* Deletes a file */
 int    fs_delete(const char *name);
 
@@ -54,4 +88,78 @@ void   fs_list(void);
 /* Returns total free space (in bytes) */
 size_t fs_get_free_space(void);
 
+/* Gets the logical size of a file */
+int    fs_stat(const char *name, size_t *out_size);
+
+/* Copies up to 'max' file names into names[]; *out_count gets the total */
+int    fs_list_names(char (*names)[FS_MAX_FILENAME],
+                     size_t max,
+                     size_t *out_count);
+
+/* --- Shared-memory volumes --- */
+
+/* Creates a shared volume called 'name' (e.g. "/sfs") and mounts it.
+ * An existing volume of that name is only replaced if 'replace' is set;
+ * otherwise the call fails with FS_ERR_FILE_EXISTS. */
+int    fs_serve_shared(const char *name, int replace);
+
+/* Mounts a shared volume created by another process */
+int    fs_attach_shared(const char *name);
+
+/* Unmounts the shared volume (and removes its name if we created it) */
+void   fs_detach_shared(void);
+
+/* --- Bulk copy with the host --- */
+
+/* Copies a host file into a new volume file called 'name' */
+int    fs_import(const char *host_path, const char *name);
+
+/* Copies a volume file into a host file (created or truncated) */
+int    fs_export(const char *name, const char *host_path);
+
+/* Imports every regular file under host_dir. Volume names are 'prefix'
+ * followed by the path relative to host_dir, e.g. "docs/a.txt". */
+int    fs_import_tree(const char *host_dir,
+                      const char *prefix,
+                      size_t *out_files);
+
+/* Exports every volume file under host_dir, creating the directories
+ * implied by '/' in the names */
+int    fs_export_all(const char *host_dir, size_t *out_files);
+
+/* --- Consistency checks --- */
+
+/* Findings of a consistency check */
+typedef struct {
+    size_t files;              /* Directory entries checked              */
+    size_t leaked;             /* Marked used but owned by no file       */
+    size_t unmarked;           /* Owned by a file but marked free        */
+    size_t double_allocated;   /* References to a block another file owns */
+    size_t out_of_range;       /* Block indices outside the volume       */
+    size_t bad_entries;        /* Entries with an impossible block_count  */
+    size_t bad_counters;       /* Block counters that disagree with the map */
+    size_t repaired;           /* Problems fixed (repair mode only)       */
+    size_t unrepaired;         /* Problems that could not be fixed        */
+} FsckReport;
+
+/* Checks (and optionally repairs) the mounted volume, pausing creates
+ * and deletes while it runs */
+int    fs_check(int repair, FsckReport *report);
+
+/* Returns 1 if the report has no problems */
+int    fsck_clean(const FsckReport *report);
+
+/* Prints a report to stdout */
+void   fsck_print_report(const FsckReport *report);
+
+/* --- Operation traces --- */
+
+/* Starts recording every fs_* call to 'path'. With 'with_data' set, write
+ * payloads are stored too so a replay writes the same bytes. */
+int    fs_trace_start(const char *path, int with_data);
+
+/* Stops recording and closes the trace. Returns FS_ERR_IO if any part of
+ * the trace could not be written (e.g. a full disk). */
+int    fs_trace_stop(void);
+
 #endif
@@ -0,0 +1,257 @@
+#include "fsck.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* A block reference that repair has to replace */
+typedef struct {
+    int entry;
+    int slot;
+} BadRef;
+
+typedef struct {
+    int           id;
+    Directory    *dir;
+    BlockManager *bm;
+    atomic_int   *owner;        /* Entry index + 1 owning each block */
+    FsckReport    found;
+    BadRef       *bad;
+    size_t        bad_count;
+    size_t        bad_cap;
+    int           oom;
+} FsckWorker;
+
+static size_t blocks_for_size(size_t size) {
+    return (size + FS_BLOCK_MASK) >> FS_BLOCK_SHIFT;
+}
+
+static void push_bad(FsckWorker *w, int entry, int slot) {
+    if (w->bad_count == w->bad_cap) {
+        size_t cap = w->bad_cap ? w->bad_cap * 2 : 64;
+        BadRef *bad = (BadRef *)realloc(w->bad, cap * sizeof(BadRef));
+        if (!bad) {
+            w->oom = 1;
+            return;
+        }
+        w->bad = bad;
+        w->bad_cap = cap;
+    }
+    w->bad[w->bad_count].entry = entry;
+    w->bad[w->bad_count].slot = slot;
+    ++w->bad_count;
+}
+
+/* Phase 1: claim every referenced block for its file */
+static void *scan_entries(void *arg) {
+    FsckWorker *w = (FsckWorker *)arg;
+
+    int slots = w->dir->high_water;
+    if (slots < 0 || slots > FS_MAX_FILES) slots = FS_MAX_FILES;
+
+    for (int i = w->id; i < slots; i += FS_FSCK_THREADS) {
+        const FileEntry *e = &w->dir->entries[i];
+        if (!e->used) continue;
+        ++w->found.files;
+
+        int count = e->block_count;
+        if (count < 0 || count > FS_MAX_BLOCKS_PER_FILE ||
+            (size_t)count < blocks_for_size(e->size)) {
+            ++w->found.bad_entries;
+            if (count < 0) count = 0;
+            if (count > FS_MAX_BLOCKS_PER_FILE) count = FS_MAX_BLOCKS_PER_FILE;
+        }
+
+        for (int j = 0; j < count; ++j) {
+            int b = e->blocks[j];
+            if (b < 0 || b >= FS_NUM_BLOCKS) {
+                ++w->found.out_of_range;
+                push_bad(w, i, j);
+                continue;
+            }
+            int expected = 0;
+            if (!atomic_compare_exchange_strong(&w->owner[b], &expected, i + 1)) {
+                ++w->found.double_allocated;
+                push_bad(w, i, j);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* Phase 2: compare the claims with the bitmap and group counters */
+static void *scan_groups(void *arg) {
+    FsckWorker *w = (FsckWorker *)arg;
+
+    for (int g = w->id; g < FS_ALLOC_GROUPS; g += FS_FSCK_THREADS) {
+        int first = g * FS_BLOCKS_PER_GROUP;
+        size_t used_count = 0;
+
+        for (int b = first; b < first + FS_BLOCKS_PER_GROUP; ++b) {
+            int owned = atomic_load_explicit(&w->owner[b],
+                                             memory_order_relaxed) != 0;
+            int used = bm_is_used(w->bm, b);
+            if (used && !owned) ++w->found.leaked;
+            if (!used && owned) ++w->found.unmarked;
+            if (used) ++used_count;
+        }
+
+        if (atomic_load(&w->bm->groups[g].used_count) != used_count) {
+            ++w->found.bad_counters;
+        }
+    }
+    return NULL;
+}
+
+static void run_phase(FsckWorker *workers, void *(*fn)(void *)) {
+    pthread_t threads[FS_FSCK_THREADS];
+    int started[FS_FSCK_THREADS];
+
+    for (int t = 0; t < FS_FSCK_THREADS; ++t) {
+        started[t] = pthread_create(&threads[t], NULL, fn, &workers[t]) == 0;
+        if (!started[t]) {
+            fn(&workers[t]);
+        }
+    }
+    for (int t = 0; t < FS_FSCK_THREADS; ++t) {
+        if (started[t]) pthread_join(threads[t], NULL);
+    }
+}
+
+static void copy_block(Storage *st, int from, int to) {
+    unsigned char buf[FS_BLOCK_SIZE] = {0};
+    if (from >= 0 && from < FS_NUM_BLOCKS) {
+        storage_read(st, from, 0, buf, FS_BLOCK_SIZE);
+    }
+    storage_write(st, to, 0, buf, FS_BLOCK_SIZE);
+}
+
+static void repair(Directory *dir, BlockManager *bm, Storage *st,
+                   atomic_int *owner, FsckWorker *workers,
+                   FsckReport *report) {
+    /* Make the bitmap match the claims */
+    for (int b = 0; b < FS_NUM_BLOCKS; ++b) {
+        int owned = atomic_load_explicit(&owner[b], memory_order_relaxed) != 0;
+        if (bm_is_used(bm, b) != owned) {
+            bm_set_used(bm, b, owned);
+            ++report->repaired;
+        }
+    }
+
+    /* Give every shared or out-of-range reference a block of its own */
+    int cursor = 0;
+    for (int t = 0; t < FS_FSCK_THREADS; ++t) {
+        for (size_t k = 0; k < workers[t].bad_count; ++k) {
+            const BadRef *ref = &workers[t].bad[k];
+            while (cursor < FS_NUM_BLOCKS && bm_is_used(bm, cursor)) {
+                ++cursor;
+            }
+            if (cursor == FS_NUM_BLOCKS) {
+                ++report->unrepaired;
+                continue;
+            }
+
+            FileEntry *e = &dir->entries[ref->entry];
+            copy_block(st, e->blocks[ref->slot], cursor);
+            e->blocks[ref->slot] = cursor;
+            bm_set_used(bm, cursor, 1);
+            ++report->repaired;
+        }
+    }
+
+    /* Entries with a bad block_count cannot be rebuilt from anything */
+    report->unrepaired += report->bad_entries;
+
+    bm_recount(bm);
+    report->repaired += report->bad_counters;
+}
+
+int fsck_run(Directory *dir,
+             BlockManager *bm,
+             Storage *st,
+             int repair_mode,
+             FsckReport *report) {
+    if (!dir || !bm || !st || !report) return FS_ERR_INVALID_ARGUMENT;
+    memset(report, 0, sizeof(*report));
+
+    atomic_int *owner = (atomic_int *)calloc(FS_NUM_BLOCKS, sizeof(atomic_int));
+    if (!owner) return FS_ERR_NO_SPACE;
+
+    FsckWorker workers[FS_FSCK_THREADS];
+    memset(workers, 0, sizeof(workers));
+    for (int t = 0; t < FS_FSCK_THREADS; ++t) {
+        workers[t].id = t;
+        workers[t].dir = dir;
+        workers[t].bm = bm;
+        workers[t].owner = owner;
+    }
+
+    run_phase(workers, scan_entries);
+    run_phase(workers, scan_groups);
+
+    int oom = 0;
+    for (int t = 0; t < FS_FSCK_THREADS; ++t) {
+        const FsckReport *f = &workers[t].found;
+        report->files            += f->files;
+        report->leaked           += f->leaked;
+        report->unmarked         += f->unmarked;
+        report->double_allocated += f->double_allocated;
+        report->out_of_range     += f->out_of_range;
+        report->bad_entries      += f->bad_entries;
+        report->bad_counters     += f->bad_counters;
+        oom |= workers[t].oom;
+    }
+
+    /* No allocation is in flight, so nothing may be reserved beyond the
+     * blocks actually in use */
+    size_t used_total = 0;
+    for (int b = 0; b < FS_NUM_BLOCKS; ++b) {
+        if (bm_is_used(bm, b)) ++used_total;
+    }
+    if (atomic_load(&bm->claimed) != used_total) {
+        ++report->bad_counters;
+    }
+
+    if (repair_mode && !oom) {
+        repair(dir, bm, st, owner, workers, report);
+    }
+
+    for (int t = 0; t < FS_FSCK_THREADS; ++t) {
+        free(workers[t].bad);
+    }
+    free(owner);
+    return oom ? FS_ERR_NO_SPACE : FS_OK;
+}
+
+int fsck_clean(const FsckReport *report) {
+    if (!report) return 0;
+    return report->leaked == 0 &&
+           report->unmarked == 0 &&
+           report->double_allocated == 0 &&
+           report->out_of_range == 0 &&
+           report->bad_entries == 0 &&
+           report->bad_counters == 0;
+}
+
+void fsck_print_report(const FsckReport *report) {
+    if (!report) return;
+
+    printf("Checked %zu files, %d blocks.\n", report->files, FS_NUM_BLOCKS);
+    if (fsck_clean(report)) {
+        printf("Volume is consistent.\n");
+        return;
+    }
+
+    printf("  leaked blocks:           %zu\n", report->leaked);
+    printf("  unmarked blocks:         %zu\n", report->unmarked);
+    printf("  double-allocated blocks: %zu\n", report->double_allocated);
+    printf("  out-of-range blocks:     %zu\n", report->out_of_range);
+    printf("  bad entries:             %zu\n", report->bad_entries);
+    printf("  bad group counters:      %zu\n", report->bad_counters);
+    if (report->repaired || report->unrepaired) {
+        printf("Repaired %zu problems, %zu left.\n",
+               report->repaired, report->unrepaired);
+    }
+}
@@ -0,0 +1,22 @@
+#ifndef FSCK_H
+#define FSCK_H
+
+#include "filesystem.h"
+#include "directory.h"
+#include "block_manager.h"
+#include "storage.h"
+
+#define FS_FSCK_THREADS 4               /* Worker threads per check */
+
+/* Rebuilds the expected block map from the directory and compares it with
+ * the Block Manager. With 'repair' set, leaked blocks are freed, unmarked
+ * ones marked, and every shared or out-of-range reference gets a fresh
+ * block (a copy of the shared one, or zeros). The caller must keep the
+ * volume quiet while this runs. */
+int fsck_run(Directory *dir,
+             BlockManager *bm,
+             Storage *st,
+             int repair,
+             FsckReport *report);
+
+#endif
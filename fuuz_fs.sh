@@ -3,8 +3,11 @@
 BIN=./sfs
 OPS=2000                    # Total operations to perform
 MAX_FILES=200               # Range of possible files
-SEED=$RANDOM                # Seed for reproducibility
-RATE_LIMIT=0.002            # Pause between operations (2 ms)
+SEED=${SEED:-$RANDOM}       # Seed for reproducibility (SEED=n ./fuuz_fs.sh)
+RATE_LIMIT=${RATE_LIMIT:-0.002} # Pause between operations (2 ms)
+TRACE=${TRACE:-}            # Record a binary trace for sfs_replay (TRACE=file)
+
+RANDOM=$SEED                # Every $RANDOM below now follows the seed
 
 echo "========== FS FUZZ TESTER =========="
 echo "Binary: $BIN"
@@ -17,7 +20,11 @@ PIPE=$(mktemp -u)
 mkfifo $PIPE
 
 # Run the FS
-$BIN < $PIPE &
+if [ -n "$TRACE" ]; then
+    $BIN --trace "$TRACE" < $PIPE &
+else
+    $BIN < $PIPE &
+fi
 PID=$!
 exec 3> $PIPE
 
@@ -30,9 +37,15 @@ send() {
     echo "$1" >&3
 }
 
+# Sets DATA instead of echoing it: $(...) would run in a subshell, where
+# bash reseeds $RANDOM and the payloads would no longer follow SEED
 random_string() {
-    LEN=$((RANDOM % 20 + 5))
-    tr -cd 'A-Za-z0-9' < /dev/urandom | head -c $LEN
+    local CHARS='ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789'
+    local LEN=$((RANDOM % 20 + 5))
+    DATA=''
+    for ((k=0; k<LEN; k++)); do
+        DATA+=${CHARS:$((RANDOM % 62)):1}
+    done
 }
 
 echo "=== Fuzzing started ==="
@@ -53,7 +66,7 @@ for ((i=1; i<=OPS; i++)); do
         # 20–40%: WRITE
         [2-3]*)
             OFFSET=$((RANDOM % 2048))
-            DATA=$(random_string)
+            random_string
             send "WRITE $FILE $OFFSET \"$DATA\""
         ;;
 
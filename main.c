@@ -1,7 +1,10 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "filesystem.h"
 
@@ -73,6 +76,9 @@ static void print_fs_error(int code) {
         case FS_ERR_INVALID_ARGUMENT:
             printf("Error: invalid argument.\n");
             break;
+        case FS_ERR_IO:
+            printf("Error: host or shared volume I/O failed.\n");
+            break;
         default:
             printf("Unknown error (%d).\n", code);
             break;
@@ -86,12 +92,60 @@ static void print_help(void) {
     printf("  READ   <filename> <offset> <size>\n");
     printf("  DELETE <filename>\n");
     printf("  LIST\n");
+    printf("  IMPORT <host_path> [name]   (a host directory is imported recursively)\n");
+    printf("  EXPORT <name> <host_path>   (use * as name to export every file)\n");
+    printf("  FSCK [REPAIR]\n");
     printf("  EXIT\n");
 }
 
-int main(void) {
+static void print_usage(const char *prog) {
+    printf("Usage: %s [--serve <name> | --replace <name> | --attach <name>] [--trace <file>]\n", prog);
+    printf("  --serve   <name>  create shared volume <name> (e.g. /sfs) and use it\n");
+    printf("  --replace <name>  like --serve, but replace a volume that already exists\n");
+    printf("  --attach  <name>  use a shared volume created by another process\n");
+    printf("  --trace   <file>  record every operation to <file> for sfs_replay\n");
+}
+
+int main(int argc, char **argv) {
     fs_init();
 
+    const char *trace_path = NULL;
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        if (i + 1 >= argc) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+
+        int rc = FS_OK;
+        if (strcmp(arg, "--serve") == 0 || strcmp(arg, "--replace") == 0) {
+            rc = fs_serve_shared(value, strcmp(arg, "--replace") == 0);
+            if (rc == FS_OK) printf("Serving shared volume '%s'.\n", value);
+        } else if (strcmp(arg, "--attach") == 0) {
+            rc = fs_attach_shared(value);
+            if (rc == FS_OK) printf("Attached to shared volume '%s'.\n", value);
+        } else if (strcmp(arg, "--trace") == 0) {
+            trace_path = value;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+        if (rc != FS_OK) {
+            print_fs_error(rc);
+            return 1;
+        }
+    }
+
+    /* Started last so the trace begins on the volume we will use */
+    if (trace_path) {
+        int rc = fs_trace_start(trace_path, 1);
+        if (rc != FS_OK) {
+            print_fs_error(rc);
+            return 1;
+        }
+    }
+
     printf("Filesystem Simulator\n");
     printf("Total space: %zu bytes, block: %d bytes, max files: %d\n",
            (size_t)FS_TOTAL_SIZE, FS_BLOCK_SIZE, FS_MAX_FILES);
@@ -228,10 +282,106 @@ int main(void) {
             continue;
         }
 
+        if (strcmp(command, "IMPORT") == 0) {
+            char host_path[MAX_LINE];
+            char name[FS_MAX_FILENAME] = {0};
+
+            int scanned = sscanf(line, "%*s %2047s %63s", host_path, name);
+            if (scanned < 1) {
+                printf("Usage: IMPORT <host_path> [name]\n");
+                continue;
+            }
+
+            struct stat st;
+            if (stat(host_path, &st) == 0 && S_ISDIR(st.st_mode)) {
+                char prefix[FS_MAX_FILENAME + 1] = {0};
+                size_t plen = strlen(name);
+                if (plen > 0) {
+                    snprintf(prefix, sizeof(prefix), "%s%s", name,
+                             name[plen - 1] == '/' ? "" : "/");
+                }
+
+                size_t files = 0;
+                int rc = fs_import_tree(host_path, prefix, &files);
+                if (rc != FS_OK) {
+                    print_fs_error(rc);
+                }
+                printf("Imported %zu files from '%s'.\n", files, host_path);
+                continue;
+            }
+
+            if (scanned < 2) {
+                const char *base = strrchr(host_path, '/');
+                base = base ? base + 1 : host_path;
+                if (strlen(base) >= sizeof(name)) {
+                    print_fs_error(FS_ERR_INVALID_ARGUMENT);
+                    continue;
+                }
+                strcpy(name, base);
+            }
+
+            int rc = fs_import(host_path, name);
+            if (rc != FS_OK) {
+                print_fs_error(rc);
+            } else {
+                printf("Imported '%s' as '%s'.\n", host_path, name);
+            }
+            continue;
+        }
+
+        if (strcmp(command, "EXPORT") == 0) {
+            char name[FS_MAX_FILENAME];
+            char host_path[MAX_LINE];
+
+            int scanned = sscanf(line, "%*s %63s %2047s", name, host_path);
+            if (scanned != 2) {
+                printf("Usage: EXPORT <name> <host_path>\n");
+                continue;
+            }
+
+            if (strcmp(name, "*") == 0) {
+                size_t files = 0;
+                int rc = fs_export_all(host_path, &files);
+                if (rc != FS_OK) {
+                    print_fs_error(rc);
+                }
+                printf("Exported %zu files to '%s'.\n", files, host_path);
+                continue;
+            }
+
+            int rc = fs_export(name, host_path);
+            if (rc != FS_OK) {
+                print_fs_error(rc);
+            } else {
+                printf("Exported '%s' to '%s'.\n", name, host_path);
+            }
+            continue;
+        }
+
+        if (strcmp(command, "FSCK") == 0) {
+            char mode[16] = {0};
+            sscanf(line, "%*s %15s", mode);
+            str_to_upper(mode);
+
+            FsckReport report;
+            int rc = fs_check(strcmp(mode, "REPAIR") == 0, &report);
+            if (rc != FS_OK) {
+                print_fs_error(rc);
+            } else {
+                fsck_print_report(&report);
+            }
+            continue;
+        }
+
         printf("Unknown command: %s\n", command);
         printf("Type 'HELP' to see the list of commands.\n");
     }
 
+    int trace_rc = fs_trace_stop();
+    if (trace_rc != FS_OK) {
+        printf("Error: trace '%s' is incomplete (write failed).\n", trace_path);
+    }
+    fs_detach_shared();
     printf("Exiting the simulator.\n");
-    return 0;
+    return trace_rc == FS_OK ? 0 : 1;
 }
@@ -0,0 +1,46 @@
+#include "readahead.h"
+
+#include <string.h>
+
+static _Thread_local ReadStream    t_streams[FS_RA_STREAMS];
+static _Thread_local unsigned long t_tick = 0;
+
+ReadStream *ra_stream(const char *name) {
+    if (!name) return NULL;
+
+    ReadStream *victim = &t_streams[0];
+    for (int i = 0; i < FS_RA_STREAMS; ++i) {
+        ReadStream *rs = &t_streams[i];
+        if (rs->last_use != 0 &&
+            strncmp(rs->name, name, FS_MAX_FILENAME) == 0) {
+            rs->last_use = ++t_tick;
+            return rs;
+        }
+        if (rs->last_use < victim->last_use) {
+            victim = rs;
+        }
+    }
+
+    strncpy(victim->name, name, FS_MAX_FILENAME - 1);
+    victim->name[FS_MAX_FILENAME - 1] = '\0';
+    victim->slot = -1;
+    victim->last_use = ++t_tick;
+    return victim;
+}
+
+FileEntry *ra_lookup(ReadStream *rs, Directory *dir, const char *name) {
+    if (!dir || !name) return NULL;
+
+    if (rs && rs->slot >= 0) {
+        FileEntry *e = dir_get(dir, rs->slot);
+        if (e && strncmp(e->name, name, FS_MAX_FILENAME) == 0) {
+            return e;
+        }
+    }
+
+    int idx = dir_find(dir, name);
+    if (rs) {
+        rs->slot = idx;
+    }
+    return idx == -1 ? NULL : dir_get(dir, idx);
+}
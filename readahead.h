@@ -0,0 +1,26 @@
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "filesystem.h"
+#include "directory.h"
+
+/* --- Per-thread read streams --- */
+
+#define FS_RA_STREAMS     8             /* Streams tracked per thread        */
+
+/* What one thread knows about its reads of one file */
+typedef struct {
+    char          name[FS_MAX_FILENAME];
+    int           slot;                 /* Directory index last seen, or -1 */
+    unsigned long last_use;
+} ReadStream;
+
+/* Finds the calling thread's stream for 'name', recycling the least
+ * recently used one if it is new */
+ReadStream *ra_stream(const char *name);
+
+/* Resolves 'name' through the slot cached in the stream, falling back
+ * to dir_find; NULL if the file does not exist */
+FileEntry  *ra_lookup(ReadStream *rs, Directory *dir, const char *name);
+
+#endif
@@ -0,0 +1,38 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "filesystem.h"
+
+/* Exit codes follow fsck(8) */
+#define FSCK_EXIT_OK          0
+#define FSCK_EXIT_CORRECTED   1
+#define FSCK_EXIT_UNCORRECTED 4
+#define FSCK_EXIT_OPERATIONAL 8
+#define FSCK_EXIT_USAGE       16
+
+int main(int argc, char **argv) {
+    int repair = argc == 3 && strcmp(argv[2], "--repair") == 0;
+    if (argc != 2 && !repair) {
+        printf("Usage: %s <shared_volume> [--repair]\n", argv[0]);
+        return FSCK_EXIT_USAGE;
+    }
+
+    fs_init();
+    if (fs_attach_shared(argv[1]) != FS_OK) {
+        printf("Error: could not attach to shared volume '%s'.\n", argv[1]);
+        return FSCK_EXIT_OPERATIONAL;
+    }
+
+    FsckReport report;
+    int rc = fs_check(repair, &report);
+    fs_detach_shared();
+    if (rc != FS_OK) {
+        printf("Error: check failed (%d).\n", rc);
+        return FSCK_EXIT_OPERATIONAL;
+    }
+
+    fsck_print_report(&report);
+    if (fsck_clean(&report)) return FSCK_EXIT_OK;
+    if (repair && report.unrepaired == 0) return FSCK_EXIT_CORRECTED;
+    return FSCK_EXIT_UNCORRECTED;
+}
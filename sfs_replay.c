@@ -0,0 +1,376 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "filesystem.h"
+#include "trace.h"
+
+/* Replays a trace recorded with 'sfs --trace' on a fresh volume and
+ * compares per-operation latency with the recording.
+ * Usage: sfs_replay <trace> [--timed] [--threads N] */
+
+#define REPLAY_MAX_THREADS 64
+
+typedef struct {
+    TraceRecord rec;
+    char        name[FS_MAX_FILENAME];
+    char       *data;                  /* Recorded payload, or NULL */
+    uint64_t   *lens;                  /* Buffer lengths of WRITEV/READV */
+    uint64_t    replay_ns;
+    int         replay_result;
+} ReplayOp;
+
+typedef struct {
+    ReplayOp *ops;
+    size_t    count;
+    int       id;
+    int       threads;
+    int       timed;
+    uint64_t  epoch;
+    char     *scratch;
+    size_t    scratch_len;
+} ReplayWorker;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_until(uint64_t when) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(when / 1000000000u);
+    ts.tv_nsec = (long)(when % 1000000000u);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {
+    }
+}
+
+static int load_trace(const char *path, ReplayOp **out_ops, size_t *out_count) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return FS_ERR_IO;
+
+    TraceHeader hdr;
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        memcmp(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic)) != 0 ||
+        hdr.version < 1 || hdr.version > TRACE_VERSION) {
+        fclose(f);
+        return FS_ERR_INVALID_ARGUMENT;
+    }
+    if (hdr.block_shift != FS_BLOCK_SHIFT) {
+        printf("Warning: trace was recorded with %u-byte blocks, replaying with %d.\n",
+               1u << hdr.block_shift, FS_BLOCK_SIZE);
+    }
+
+    ReplayOp *ops = NULL;
+    size_t count = 0, cap = 0;
+    int rc = FS_OK;
+    TraceRecord rec;
+
+    while (fread(&rec, sizeof(rec), 1, f) == 1) {
+        if (count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            ReplayOp *grown = (ReplayOp *)realloc(ops, cap * sizeof(ReplayOp));
+            if (!grown) {
+                rc = FS_ERR_NO_SPACE;
+                break;
+            }
+            ops = grown;
+        }
+
+        ReplayOp *op = &ops[count];
+        memset(op, 0, sizeof(*op));
+        op->rec = rec;
+        if (rec.name_len >= FS_MAX_FILENAME ||
+            fread(op->name, 1, rec.name_len, f) != rec.name_len) {
+            rc = FS_ERR_INVALID_ARGUMENT;
+            break;
+        }
+        if (rec.iovcnt > 0) {
+            op->lens = (uint64_t *)malloc(rec.iovcnt * sizeof(uint64_t));
+            if (!op->lens ||
+                fread(op->lens, sizeof(uint64_t), rec.iovcnt, f) != rec.iovcnt) {
+                free(op->lens);
+                rc = FS_ERR_INVALID_ARGUMENT;
+                break;
+            }
+            uint64_t sum = 0;
+            for (uint32_t i = 0; i < rec.iovcnt; ++i) sum += op->lens[i];
+            if (sum != rec.size) {
+                free(op->lens);
+                rc = FS_ERR_INVALID_ARGUMENT;
+                break;
+            }
+        }
+        if (rec.flags & TRACE_HAS_DATA) {
+            op->data = (char *)malloc(rec.size ? rec.size : 1);
+            if (!op->data || fread(op->data, 1, rec.size, f) != rec.size) {
+                free(op->data);
+                free(op->lens);
+                rc = FS_ERR_INVALID_ARGUMENT;
+                break;
+            }
+        }
+        ++count;
+    }
+    fclose(f);
+
+    *out_ops = ops;
+    *out_count = count;
+    return rc;
+}
+
+/* Operations on the same file stay on one thread and keep their order */
+static int worker_for(const ReplayOp *op, int threads) {
+    unsigned h = 5381;
+    for (const char *p = op->name; *p; ++p) {
+        h = h * 33 + (unsigned char)*p;
+    }
+    return (int)(h % (unsigned)threads);
+}
+
+static char *scratch(ReplayWorker *w, size_t len) {
+    if (len == 0) len = 1;
+    if (len > w->scratch_len) {
+        char *buf = (char *)realloc(w->scratch, len);
+        if (!buf) return NULL;
+        memset(buf + w->scratch_len, 0, len - w->scratch_len);
+        w->scratch = buf;
+        w->scratch_len = len;
+    }
+    return w->scratch;
+}
+
+/* Cuts 'base' into the recorded buffer lengths of a vectored call */
+static FsIovec *split_iov(const ReplayOp *op, char *base) {
+    FsIovec *iov = (FsIovec *)malloc(op->rec.iovcnt * sizeof(FsIovec));
+    if (!iov) return NULL;
+
+    size_t pos = 0;
+    for (uint32_t i = 0; i < op->rec.iovcnt; ++i) {
+        iov[i].base = base + pos;
+        iov[i].len = (size_t)op->lens[i];
+        pos += iov[i].len;
+    }
+    return iov;
+}
+
+/* Replays a WRITEV or READV with the recorded buffer layout */
+static int run_vectored(ReplayWorker *w, ReplayOp *op) {
+    const TraceRecord *r = &op->rec;
+    int writing = r->op == TRACE_OP_WRITEV;
+
+    char *base = writing && op->data ? op->data : scratch(w, r->size);
+    if (!base) return FS_ERR_NO_SPACE;
+    if (r->iovcnt == 0) {
+        return writing ? fs_writev(op->name, r->offset, NULL, 0, NULL)
+                       : fs_readv(op->name, r->offset, NULL, 0, NULL);
+    }
+
+    FsIovec *iov = split_iov(op, base);
+    if (!iov) return FS_ERR_NO_SPACE;
+    int rc = writing ? fs_writev(op->name, r->offset, iov, (int)r->iovcnt, NULL)
+                     : fs_readv(op->name, r->offset, iov, (int)r->iovcnt, NULL);
+    free(iov);
+    return rc;
+}
+
+static int run_op(ReplayWorker *w, ReplayOp *op) {
+    const TraceRecord *r = &op->rec;
+    size_t size = 0;
+
+    switch (r->op) {
+        case TRACE_OP_CREATE:
+            return fs_create(op->name, r->size);
+        case TRACE_OP_WRITE: {
+            const char *data = op->data ? op->data : scratch(w, r->size);
+            if (!data) return FS_ERR_NO_SPACE;
+            return fs_write(op->name, r->offset, data, r->size, NULL);
+        }
+        case TRACE_OP_READ: {
+            char *buf = scratch(w, r->size);
+            if (!buf) return FS_ERR_NO_SPACE;
+            return fs_read(op->name, r->offset, r->size, buf, NULL);
+        }
+        case TRACE_OP_DELETE:
+            return fs_delete(op->name);
+        case TRACE_OP_LIST:
+            fs_list();
+            return FS_OK;
+        case TRACE_OP_FREE_SPACE:
+            fs_get_free_space();
+            return FS_OK;
+        case TRACE_OP_STAT:
+            return fs_stat(op->name, &size);
+        case TRACE_OP_WRITEV:
+        case TRACE_OP_READV:
+            return run_vectored(w, op);
+        default:
+            return FS_ERR_INVALID_ARGUMENT;
+    }
+}
+
+static void *replay_main(void *arg) {
+    ReplayWorker *w = (ReplayWorker *)arg;
+
+    for (size_t i = 0; i < w->count; ++i) {
+        ReplayOp *op = &w->ops[i];
+        if (worker_for(op, w->threads) != w->id) continue;
+
+        if (w->timed) {
+            sleep_until(w->epoch + op->rec.start_ns);
+        }
+        uint64_t t0 = now_ns();
+        op->replay_result = run_op(w, op);
+        op->replay_ns = now_ns() - t0;
+    }
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Prints mean, p50 and p99 of n samples (sorted in place), in microseconds */
+static void print_stats(uint64_t *v, size_t n) {
+    qsort(v, n, sizeof(*v), cmp_u64);
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) sum += (double)v[i];
+    printf(" %9.2f %9.2f %9.2f", sum / (double)n / 1e3,
+           (double)v[n / 2] / 1e3, (double)v[(n * 99) / 100] / 1e3);
+}
+
+static void print_report(const ReplayOp *ops, size_t count, double wall) {
+    printf("\nReplayed %zu operations in %.3f s (%.0f ops/s).\n",
+           count, wall, wall > 0 ? (double)count / wall : 0.0);
+    printf("%-10s %8s |%9s %9s %9s |%9s %9s %9s | %s\n",
+           "op", "count", "rec mean", "rec p50", "rec p99",
+           "run mean", "run p50", "run p99", "result diffs");
+
+    uint64_t *rec = (uint64_t *)malloc((count ? count : 1) * sizeof(uint64_t));
+    uint64_t *run = (uint64_t *)malloc((count ? count : 1) * sizeof(uint64_t));
+    if (!rec || !run) {
+        free(rec);
+        free(run);
+        return;
+    }
+
+    for (int op = 1; op < TRACE_OP_COUNT; ++op) {
+        size_t n = 0, diffs = 0;
+        for (size_t i = 0; i < count; ++i) {
+            if (ops[i].rec.op != op) continue;
+            rec[n] = ops[i].rec.duration_ns;
+            run[n] = ops[i].replay_ns;
+            if (ops[i].replay_result != ops[i].rec.result) ++diffs;
+            ++n;
+        }
+        if (n == 0) continue;
+
+        printf("%-10s %8zu |", trace_op_name(op), n);
+        print_stats(rec, n);
+        printf(" |");
+        print_stats(run, n);
+        printf(" | %zu\n", diffs);
+    }
+    printf("(latencies in microseconds)\n");
+
+    free(rec);
+    free(run);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    int timed = 0;
+    int threads = 1;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--timed") == 0) {
+            timed = 1;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (!path) {
+            path = argv[i];
+        } else {
+            path = NULL;
+            break;
+        }
+    }
+    if (!path || threads < 1 || threads > REPLAY_MAX_THREADS) {
+        printf("Usage: %s <trace> [--timed] [--threads N]\n", argv[0]);
+        return 1;
+    }
+
+    ReplayOp *ops = NULL;
+    size_t count = 0;
+    int rc = load_trace(path, &ops, &count);
+    if (rc != FS_OK) {
+        printf("Error: could not load trace '%s' (%d).\n", path, rc);
+        for (size_t i = 0; i < count; ++i) {
+            free(ops[i].data);
+            free(ops[i].lens);
+        }
+        free(ops);
+        return 1;
+    }
+
+    fs_init();
+
+    /* Keep LIST output out of the report */
+    fflush(stdout);
+    int saved_stdout = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY);
+    if (devnull >= 0) {
+        dup2(devnull, STDOUT_FILENO);
+        close(devnull);
+    }
+
+    ReplayWorker workers[REPLAY_MAX_THREADS];
+    pthread_t tids[REPLAY_MAX_THREADS];
+    uint64_t epoch = now_ns();
+
+    for (int t = 0; t < threads; ++t) {
+        memset(&workers[t], 0, sizeof(workers[t]));
+        workers[t].ops = ops;
+        workers[t].count = count;
+        workers[t].id = t;
+        workers[t].threads = threads;
+        workers[t].timed = timed;
+        workers[t].epoch = epoch;
+    }
+    int started[REPLAY_MAX_THREADS] = {0};
+    for (int t = 1; t < threads; ++t) {
+        started[t] = pthread_create(&tids[t], NULL, replay_main,
+                                    &workers[t]) == 0;
+    }
+    replay_main(&workers[0]);
+    for (int t = 1; t < threads; ++t) {
+        if (started[t]) {
+            pthread_join(tids[t], NULL);
+        } else {
+            replay_main(&workers[t]);
+        }
+    }
+    double wall = (double)(now_ns() - epoch) / 1e9;
+
+    fflush(stdout);
+    if (saved_stdout >= 0) {
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    print_report(ops, count, wall);
+
+    for (int t = 0; t < threads; ++t) free(workers[t].scratch);
+    for (size_t i = 0; i < count; ++i) {
+        free(ops[i].data);
+        free(ops[i].lens);
+    }
+    free(ops);
+    return 0;
+}
@@ -1,43 +1,40 @@
 #include "storage.h"
 #include <string.h>
 
-void storage_init(Storage *s) {
-    if (!s) return;
-    memset(s->data, 0, sizeof(s->data));
-}
-
-int storage_write_byte(Storage *s,
-                       int block_index,
-                       size_t block_offset,
-                       unsigned char value) {
-    if (!s) return FS_ERR_INVALID_ARGUMENT;
+int storage_write(Storage *s,
+                  int block_index,
+                  size_t block_offset,
+                  const void *src,
+                  size_t len) {
+    if (!s || (!src && len > 0)) return FS_ERR_INVALID_ARGUMENT;
 
     if (block_index < 0 || block_index >= FS_NUM_BLOCKS) {
         return FS_ERR_OUT_OF_BOUNDS;
     }
-    if (block_offset >= FS_BLOCK_SIZE) {
+    if (block_offset > FS_BLOCK_SIZE || len > FS_BLOCK_SIZE - block_offset) {
         return FS_ERR_OUT_OF_BOUNDS;
     }
 
-    size_t pos = (size_t)block_index * FS_BLOCK_SIZE + block_offset;
-    s->data[pos] = value;
+    size_t pos = ((size_t)block_index << FS_BLOCK_SHIFT) | block_offset;
+    memcpy(&s->data[pos], src, len);
     return FS_OK;
 }
 
-int storage_read_byte(Storage *s,
-                      int block_index,
-                      size_t block_offset,
-                      unsigned char *out_value) {
-    if (!s || !out_value) return FS_ERR_INVALID_ARGUMENT;
+int storage_read(Storage *s,
+                 int block_index,
+                 size_t block_offset,
+                 void *dst,
+                 size_t len) {
+    if (!s || (!dst && len > 0)) return FS_ERR_INVALID_ARGUMENT;
 
     if (block_index < 0 || block_index >= FS_NUM_BLOCKS) {
         return FS_ERR_OUT_OF_BOUNDS;
     }
-    if (block_offset >= FS_BLOCK_SIZE) {
+    if (block_offset > FS_BLOCK_SIZE || len > FS_BLOCK_SIZE - block_offset) {
         return FS_ERR_OUT_OF_BOUNDS;
     }
 
-    size_t pos = (size_t)block_index * FS_BLOCK_SIZE + block_offset;
-    *out_value = s->data[pos];
+    size_t pos = ((size_t)block_index << FS_BLOCK_SHIFT) | block_offset;
+    memcpy(dst, &s->data[pos], len);
     return FS_OK;
 }
@@ -3,24 +3,27 @@
 
 #include "filesystem.h"
 
-/* Represents the storage of the filesystem */
+/* Represents the storage of the filesystem. It is never cleared up front:
+ * volumes are carved from fresh zero-filled mappings, so the kernel only
+ * materializes the pages that blocks are written to. */
 typedef struct {
     unsigned char data[FS_TOTAL_SIZE];
 } Storage;
 
-/* Initializes the storage */
-void storage_init(Storage *s);
+/* Writes len bytes to a block, starting at block_offset; the range must
+ * stay inside the block */
+int  storage_write(Storage *s,
+                   int block_index,
+                   size_t block_offset,
+                   const void *src,
+                   size_t len);
 
-/* Writes a byte to a specific block in the storage */
-int  storage_write_byte(Storage *s,
-                        int block_index,
-                        size_t block_offset,
-                        unsigned char value);
-
-/* Reads a byte from a specific block in the storage */
-int  storage_read_byte(Storage *s,
-                       int block_index,
-                       size_t block_offset,
-                       unsigned char *out_value);
+/* Reads len bytes from a block, starting at block_offset; the range must
+ * stay inside the block */
+int  storage_read(Storage *s,
+                  int block_index,
+                  size_t block_offset,
+                  void *dst,
+                  size_t len);
 
 #endif 
@@ -10,12 +10,18 @@ if [ ! -f "$BIN" ]; then
     exit 1
 fi
 
+# Host files for the IMPORT/EXPORT round trip
+HOST_IN=$(mktemp)
+HOST_OUT=$(mktemp -u)
+head -c 3000 /dev/urandom > "$HOST_IN"
+
 # Create a temporary FIFO to interact with the process
 PIPE=$(mktemp -u)
+LOG=$(mktemp)
 mkfifo $PIPE
 
-# Run the FS in the background
-$BIN < $PIPE & 
+# Run the FS in the background; its output is shown and checked at the end
+$BIN < $PIPE > $LOG &
 PID=$!
 
 exec 3> $PIPE
@@ -59,8 +65,17 @@ for i in $(seq 1 10); do
     send "DELETE file$i.txt"
 done
 
+### TEST 7: Host transfer and fsck ###
+echo "[7] Import/export and fsck..."
+send "IMPORT $HOST_IN imported.bin"
+send "EXPORT imported.bin $HOST_OUT"
+send "FSCK"
+send "FSCK REPAIR"
+send "DELETE imported.bin"
+send "FSCK"
+
 ### FINAL TEST: Listing ###
-echo "[7] Final listing..."
+echo "[8] Final listing..."
 send "LIST"
 
 # Exit
@@ -70,6 +85,23 @@ sleep 1
 
 kill $PID 2>/dev/null
 rm -f $PIPE
+cat $LOG
+
+if [ "$(grep -c "Volume is consistent." $LOG)" -eq 3 ]; then
+    echo "FSCK reports a consistent volume: OK"
+else
+    echo "FSCK reports a consistent volume: FAILED"
+    STATUS=1
+fi
+
+if cmp -s "$HOST_IN" "$HOST_OUT"; then
+    echo "Import/export round trip: OK"
+else
+    echo "Import/export round trip: FAILED"
+    STATUS=1
+fi
+rm -f "$HOST_IN" "$HOST_OUT" $LOG
 
 echo "===== TESTS COMPLETED ====="
+exit ${STATUS:-0}
 
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+REPLAY=./sfs_replay
+SEED=${SEED:-42}
+
+echo "Trace Record/Replay Test"
+
+# Check if the binaries exist
+if [ ! -f ./sfs ] || [ ! -f "$REPLAY" ]; then
+    echo "Error: sfs or sfs_replay does not exist. Run 'make' first."
+    exit 1
+fi
+
+TRACE=$(mktemp)
+OUT=$(mktemp)
+
+### Record a seeded fuzz run ###
+echo "[1] Recording fuzz run (seed $SEED)..."
+SEED=$SEED TRACE=$TRACE RATE_LIMIT=0 bash fuuz_fs.sh > /dev/null 2>&1
+
+### Replay it on a fresh volume ###
+echo "[2] Replaying..."
+$REPLAY $TRACE > $OUT
+RC=$?
+cat $OUT
+
+# Every operation row ends in "| <result diffs>"; all must be 0
+ROWS=$(grep -cE '^[A-Z_]+ +[0-9]+ \|' $OUT)
+BAD=$(grep -E '^[A-Z_]+ +[0-9]+ \|' $OUT | awk '$NF != 0' | wc -l)
+
+if [ $RC -eq 0 ] && [ "$ROWS" -gt 0 ] && [ "$BAD" -eq 0 ]; then
+    echo "Replay matches the recording: OK"
+else
+    echo "Replay matches the recording: FAILED"
+    STATUS=1
+fi
+
+rm -f $TRACE $OUT
+
+echo "===== TESTS COMPLETED ====="
+exit ${STATUS:-0}
@@ -0,0 +1,107 @@
+#!/bin/bash
+
+BIN=./sfs
+FSCK=./sfs_fsck
+NAME=/sfs_test
+
+echo "Shared Volume Tests"
+
+# Check if the binaries exist
+if [ ! -f "$BIN" ] || [ ! -f "$FSCK" ]; then
+    echo "Error: sfs or sfs_fsck does not exist. Run 'make' first."
+    exit 1
+fi
+
+# Helper to record a result
+check() {
+    if [ "$2" = "0" ]; then
+        echo "  $1: OK"
+    else
+        echo "  $1: FAILED"
+        STATUS=1
+    fi
+}
+
+# Drop a volume left behind by an aborted run
+rm -f /dev/shm${NAME}
+
+# Start the server on a FIFO, logging its output
+PIPE=$(mktemp -u)
+LOG=$(mktemp)
+mkfifo $PIPE
+$BIN --serve $NAME < $PIPE > $LOG &
+PID=$!
+exec 3> $PIPE
+
+send() {
+    echo "$1" >&3
+}
+
+send "LIST"
+sleep 0.5
+
+### TEST 1: Client writes, server reads ###
+echo "[1] Writing from an attached client..."
+printf '%s\n' 'CREATE shared.txt 1024' 'WRITE shared.txt 600 "from the client"' 'EXIT' \
+    | $BIN --attach $NAME > /dev/null
+check "attach" $?
+send "READ shared.txt 600 15"
+
+### TEST 2: Second server on the same name ###
+echo "[2] Serving an existing name..."
+echo "EXIT" | $BIN --serve $NAME > /dev/null
+[ $? -ne 0 ]
+check "second --serve refused" $?
+
+### TEST 3: fsck of the live volume ###
+echo "[3] Checking the shared volume..."
+$FSCK $NAME > /dev/null
+check "sfs_fsck exit 0" $?
+
+### TEST 4: Corruption and repair ###
+echo "[4] Repairing a corrupted volume..."
+send "CREATE owner.txt 1024"
+send "CREATE victim.txt 1024"
+send 'WRITE owner.txt 0 "OWNERDATA"'
+sleep 0.5
+
+# Point victim.txt's first block at owner.txt's. In a FileEntry (LP64) the
+# block indices start 80 bytes after the name: int used, char name[64],
+# size_t size, int block_count.
+SEG=/dev/shm${NAME}
+OWNER=$(grep -obUaF owner.txt $SEG | head -1 | cut -d: -f1)
+VICTIM=$(grep -obUaF victim.txt $SEG | head -1 | cut -d: -f1)
+dd if=$SEG of=$SEG bs=1 skip=$((OWNER + 80)) seek=$((VICTIM + 80)) count=4 \
+    conv=notrunc 2> /dev/null
+
+$FSCK $NAME > /dev/null
+[ $? -eq 4 ]
+check "sfs_fsck finds the damage (exit 4)" $?
+$FSCK $NAME --repair > /dev/null
+[ $? -eq 1 ]
+check "sfs_fsck --repair corrects it (exit 1)" $?
+$FSCK $NAME > /dev/null
+check "volume clean after repair" $?
+
+# The shared block was copied, so both files start with the same data
+send "READ victim.txt 0 9"
+
+# Exit
+send "EXIT"
+exec 3>&-
+wait $PID
+rm -f $PIPE
+
+grep -q "from the client" $LOG
+check "server reads client data" $?
+[ "$(grep -c OWNERDATA $LOG)" -eq 1 ]
+check "repaired file keeps the copied block" $?
+
+### TEST 5: Cleanup ###
+echo "[5] Segment removed on exit..."
+[ ! -e /dev/shm${NAME} ]
+check "segment gone" $?
+rm -f $LOG
+
+echo "===== TESTS COMPLETED ====="
+exit ${STATUS:-0}
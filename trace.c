@@ -0,0 +1,147 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static atomic_int      g_trace_on = 0;
+static FILE           *g_trace_file = NULL;
+static int             g_trace_data = 0;
+static int             g_trace_error = FS_OK;  /* First failed write */
+static uint64_t        g_trace_epoch = 0;
+
+static atomic_uint     g_next_thread = 0;
+static _Thread_local unsigned t_thread = 0;    /* 0 = not assigned yet */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+int fs_trace_start(const char *path, int with_data) {
+    if (!path) return FS_ERR_INVALID_ARGUMENT;
+
+    FILE *f = fopen(path, "wb");
+    if (!f) return FS_ERR_IO;
+
+    TraceHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = TRACE_VERSION;
+    hdr.block_shift = FS_BLOCK_SHIFT;
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+        fclose(f);
+        return FS_ERR_IO;
+    }
+
+    fs_trace_stop();
+
+    pthread_mutex_lock(&g_trace_lock);
+    g_trace_file = f;
+    g_trace_data = with_data;
+    g_trace_error = FS_OK;
+    g_trace_epoch = now_ns();
+    atomic_store(&g_trace_on, 1);
+    pthread_mutex_unlock(&g_trace_lock);
+    return FS_OK;
+}
+
+int fs_trace_stop(void) {
+    pthread_mutex_lock(&g_trace_lock);
+    atomic_store(&g_trace_on, 0);
+    int rc = FS_OK;
+    if (g_trace_file) {
+        if (fclose(g_trace_file) != 0) {
+            g_trace_error = FS_ERR_IO;
+        }
+        g_trace_file = NULL;
+        rc = g_trace_error;
+    }
+    pthread_mutex_unlock(&g_trace_lock);
+    return rc;
+}
+
+/* Writes len bytes to the trace, remembering the first failure; the
+ * caller holds g_trace_lock */
+static void trace_put(const void *data, size_t len) {
+    if (len > 0 && fwrite(data, 1, len, g_trace_file) != len) {
+        g_trace_error = FS_ERR_IO;
+    }
+}
+
+const char *trace_op_name(int op) {
+    static const char *names[TRACE_OP_COUNT] = {
+        "?", "CREATE", "WRITE", "READ", "DELETE", "LIST", "FREE_SPACE", "STAT",
+        "WRITEV", "READV"
+    };
+    if (op <= 0 || op >= TRACE_OP_COUNT) return "?";
+    return names[op];
+}
+
+uint64_t trace_begin(void) {
+    if (!atomic_load_explicit(&g_trace_on, memory_order_relaxed)) return 0;
+    return now_ns();
+}
+
+void trace_end(uint64_t start,
+               int op,
+               const char *name,
+               size_t offset,
+               size_t size,
+               const FsIovec *iov,
+               int iovcnt,
+               int result) {
+    if (start == 0) return;
+    uint64_t end = now_ns();
+
+    if (t_thread == 0) {
+        t_thread = atomic_fetch_add(&g_next_thread, 1) + 1;
+    }
+
+    size_t name_len = name ? strnlen(name, FS_MAX_FILENAME - 1) : 0;
+
+    TraceRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.op = (uint8_t)op;
+    rec.name_len = (uint8_t)name_len;
+    rec.result = result;
+    rec.thread = t_thread;
+    rec.offset = offset;
+    rec.size = size;
+    rec.duration_ns = end - start;
+
+    int vectored = op == TRACE_OP_WRITEV || op == TRACE_OP_READV;
+    if (vectored) {
+        if (!iov || iovcnt < 0) iovcnt = 0;
+        rec.iovcnt = (uint32_t)iovcnt;
+    }
+
+    pthread_mutex_lock(&g_trace_lock);
+    if (g_trace_file) {
+        int with_data = g_trace_data && iov && result == FS_OK &&
+                        (op == TRACE_OP_WRITE || op == TRACE_OP_WRITEV);
+        if (with_data) rec.flags |= TRACE_HAS_DATA;
+        rec.start_ns = start > g_trace_epoch ? start - g_trace_epoch : 0;
+
+        trace_put(&rec, sizeof(rec));
+        trace_put(name, name_len);
+        if (vectored) {
+            for (int i = 0; i < iovcnt; ++i) {
+                uint64_t len = iov[i].len;
+                trace_put(&len, sizeof(len));
+            }
+        }
+        if (with_data) {
+            for (int i = 0; i < iovcnt; ++i) {
+                trace_put(iov[i].base, iov[i].len);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_trace_lock);
+}
@@ -0,0 +1,68 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "filesystem.h"
+
+/* --- Binary operation traces ---
+ * A trace is a TraceHeader followed by records. Each record is a
+ * TraceRecord, then name_len bytes of file name, then for WRITEV/READV
+ * 'iovcnt' uint64_t buffer lengths, then 'size' bytes of payload when
+ * TRACE_HAS_DATA is set. Fields are in host byte order. */
+
+#define TRACE_MAGIC    "SFSTRACE"
+#define TRACE_VERSION  2               /* 2 added WRITEV/READV; 1 still reads */
+
+#define TRACE_HAS_DATA 0x0001          /* Write payload follows the name */
+
+/* Recorded operations */
+enum {
+    TRACE_OP_CREATE = 1,
+    TRACE_OP_WRITE,
+    TRACE_OP_READ,
+    TRACE_OP_DELETE,
+    TRACE_OP_LIST,
+    TRACE_OP_FREE_SPACE,
+    TRACE_OP_STAT,
+    TRACE_OP_WRITEV,
+    TRACE_OP_READV,
+    TRACE_OP_COUNT
+};
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t block_shift;              /* Geometry of the recording build */
+} TraceHeader;
+
+typedef struct {
+    uint8_t  op;                       /* TRACE_OP_*                      */
+    uint8_t  name_len;
+    uint16_t flags;                    /* TRACE_HAS_DATA                  */
+    int32_t  result;                   /* FS_OK or FS_ERR_*               */
+    uint32_t thread;                   /* Small id of the calling thread  */
+    uint32_t iovcnt;                   /* Buffers of WRITEV/READV, else 0 */
+    uint64_t offset;
+    uint64_t size;                     /* Bytes moved, or size to create  */
+    uint64_t start_ns;                 /* Since the trace was started     */
+    uint64_t duration_ns;
+} TraceRecord;
+
+/* Name of an operation ("CREATE", ...) */
+const char *trace_op_name(int op);
+
+/* Recording hook for filesystem.c. trace_begin returns 0 when no trace is
+ * running, and trace_end ignores calls whose start time is 0. 'iov' gives
+ * the payload of writes and the buffer lengths of vectored calls. */
+uint64_t trace_begin(void);
+void     trace_end(uint64_t start,
+                   int op,
+                   const char *name,
+                   size_t offset,
+                   size_t size,
+                   const FsIovec *iov,
+                   int iovcnt,
+                   int result);
+
+#endif
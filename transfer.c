@@ -0,0 +1,430 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "transfer.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define XFER_PATH_MAX 4096
+
+/* --- Reader/writer pipeline ---
+ * A producer thread fills up to FS_XFER_DEPTH buffers while the calling
+ * thread drains them, so host I/O and volume I/O overlap. A file that fits
+ * in one chunk is copied inline through a buffer of its own size. */
+
+typedef int (*xfer_fn)(void *ctx, size_t offset, char *buf, size_t len);
+
+typedef struct {
+    xfer_fn         produce;
+    void           *ctx;
+    size_t          total;
+    size_t          depth;             /* Buffers in use */
+    char           *buf[FS_XFER_DEPTH];
+    size_t          produced;          /* Chunks filled  */
+    size_t          consumed;          /* Chunks drained */
+    int             error;             /* First error, FS_OK if none */
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+} Pipeline;
+
+static size_t chunk_len(size_t total, size_t k) {
+    size_t off = k * (size_t)FS_XFER_CHUNK;
+    size_t left = total - off;
+    return left < FS_XFER_CHUNK ? left : FS_XFER_CHUNK;
+}
+
+static void pipeline_finish_step(Pipeline *p, size_t *counter, int rc) {
+    pthread_mutex_lock(&p->lock);
+    if (rc != FS_OK) {
+        if (p->error == FS_OK) p->error = rc;
+    } else {
+        ++*counter;
+    }
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void *producer_main(void *arg) {
+    Pipeline *p = (Pipeline *)arg;
+    size_t chunks = (p->total + FS_XFER_CHUNK - 1) / FS_XFER_CHUNK;
+
+    for (size_t k = 0; k < chunks; ++k) {
+        pthread_mutex_lock(&p->lock);
+        while (p->produced - p->consumed >= p->depth && p->error == FS_OK) {
+            pthread_cond_wait(&p->cond, &p->lock);
+        }
+        int stop = p->error != FS_OK;
+        pthread_mutex_unlock(&p->lock);
+        if (stop) break;
+
+        int rc = p->produce(p->ctx, k * (size_t)FS_XFER_CHUNK,
+                            p->buf[k % p->depth], chunk_len(p->total, k));
+        pipeline_finish_step(p, &p->produced, rc);
+        if (rc != FS_OK) break;
+    }
+    return NULL;
+}
+
+static char *alloc_buffer(size_t len) {
+    void *mem = NULL;
+    if (posix_memalign(&mem, FS_XFER_ALIGN, len) != 0) return NULL;
+    return (char *)mem;
+}
+
+static int run_pipeline(xfer_fn produce, xfer_fn consume,
+                        void *ctx, size_t total) {
+    if (total == 0) return FS_OK;
+
+    if (total <= FS_XFER_CHUNK) {
+        /* Nothing to overlap; a thread and full-size buffers would cost
+         * more than the copy */
+        char *buf = alloc_buffer(total);
+        if (!buf) return FS_ERR_IO;
+        int rc = produce(ctx, 0, buf, total);
+        if (rc == FS_OK) {
+            rc = consume(ctx, 0, buf, total);
+        }
+        free(buf);
+        return rc;
+    }
+
+    Pipeline p;
+    memset(&p, 0, sizeof(p));
+    p.produce = produce;
+    p.ctx = ctx;
+    p.total = total;
+
+    size_t chunks = (total + FS_XFER_CHUNK - 1) / FS_XFER_CHUNK;
+    p.depth = chunks < FS_XFER_DEPTH ? chunks : FS_XFER_DEPTH;
+    for (size_t i = 0; i < p.depth; ++i) {
+        p.buf[i] = alloc_buffer(FS_XFER_CHUNK);
+        if (!p.buf[i]) {
+            for (size_t j = 0; j < i; ++j) free(p.buf[j]);
+            return FS_ERR_IO;
+        }
+    }
+    pthread_mutex_init(&p.lock, NULL);
+    pthread_cond_init(&p.cond, NULL);
+
+    pthread_t producer;
+    if (pthread_create(&producer, NULL, producer_main, &p) != 0) {
+        p.error = FS_ERR_IO;
+    } else {
+        for (size_t k = 0; k < chunks; ++k) {
+            pthread_mutex_lock(&p.lock);
+            while (p.consumed == p.produced && p.error == FS_OK) {
+                pthread_cond_wait(&p.cond, &p.lock);
+            }
+            int stop = p.consumed == p.produced;
+            pthread_mutex_unlock(&p.lock);
+            if (stop) break;
+
+            int rc = consume(ctx, k * (size_t)FS_XFER_CHUNK,
+                             p.buf[k % p.depth], chunk_len(total, k));
+            pipeline_finish_step(&p, &p.consumed, rc);
+            if (rc != FS_OK) break;
+        }
+        pthread_join(producer, NULL);
+    }
+
+    pthread_cond_destroy(&p.cond);
+    pthread_mutex_destroy(&p.lock);
+    for (size_t i = 0; i < p.depth; ++i) free(p.buf[i]);
+    return p.error;
+}
+
+/* --- Single files --- */
+
+typedef struct {
+    int         fd;
+    const char *name;
+} FileXfer;
+
+static int host_read(void *ctx, size_t offset, char *buf, size_t len) {
+    FileXfer *x = (FileXfer *)ctx;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(x->fd, buf + done, len - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return FS_ERR_IO;
+        done += (size_t)n;
+    }
+    return FS_OK;
+}
+
+static int host_write(void *ctx, size_t offset, char *buf, size_t len) {
+    FileXfer *x = (FileXfer *)ctx;
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(x->fd, buf + done, len - done, (off_t)(offset + done));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return FS_ERR_IO;
+        done += (size_t)n;
+    }
+    return FS_OK;
+}
+
+static int volume_read(void *ctx, size_t offset, char *buf, size_t len) {
+    FileXfer *x = (FileXfer *)ctx;
+    return fs_read(x->name, offset, len, buf, NULL);
+}
+
+static int volume_write(void *ctx, size_t offset, char *buf, size_t len) {
+    FileXfer *x = (FileXfer *)ctx;
+    return fs_write(x->name, offset, buf, len, NULL);
+}
+
+int fs_import(const char *host_path, const char *name) {
+    if (!host_path || !name) return FS_ERR_INVALID_ARGUMENT;
+
+    int fd = open(host_path, O_RDONLY);
+    if (fd < 0) return FS_ERR_IO;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return FS_ERR_INVALID_ARGUMENT;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    int rc = fs_create(name, (size_t)st.st_size);
+    if (rc == FS_OK) {
+        FileXfer x = { fd, name };
+        rc = run_pipeline(host_read, volume_write, &x, (size_t)st.st_size);
+        if (rc != FS_OK) {
+            fs_delete(name);
+        }
+    }
+
+    close(fd);
+    return rc;
+}
+
+int fs_export(const char *name, const char *host_path) {
+    if (!name || !host_path) return FS_ERR_INVALID_ARGUMENT;
+
+    size_t size = 0;
+    int rc = fs_stat(name, &size);
+    if (rc != FS_OK) return rc;
+
+    int fd = open(host_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return FS_ERR_IO;
+
+    FileXfer x = { fd, name };
+    rc = run_pipeline(volume_read, host_write, &x, size);
+
+    if (close(fd) != 0 && rc == FS_OK) {
+        rc = FS_ERR_IO;
+    }
+    if (rc != FS_OK) {
+        unlink(host_path);
+    }
+    return rc;
+}
+
+/* --- Directory trees --- */
+
+typedef struct {
+    char host[XFER_PATH_MAX];
+    char name[FS_MAX_FILENAME];
+} XferJob;
+
+typedef struct {
+    XferJob      *jobs;
+    size_t        count;
+    size_t        cap;
+    int           import;
+    atomic_size_t next;
+    atomic_size_t done;
+    atomic_int    error;
+} XferPool;
+
+static void pool_fail(XferPool *pool, int rc) {
+    int expected = FS_OK;
+    atomic_compare_exchange_strong(&pool->error, &expected, rc);
+}
+
+static XferJob *pool_add(XferPool *pool) {
+    if (pool->count == pool->cap) {
+        size_t cap = pool->cap ? pool->cap * 2 : 64;
+        XferJob *jobs = (XferJob *)realloc(pool->jobs, cap * sizeof(XferJob));
+        if (!jobs) return NULL;
+        pool->jobs = jobs;
+        pool->cap = cap;
+    }
+    return &pool->jobs[pool->count++];
+}
+
+static void *pool_worker(void *arg) {
+    XferPool *pool = (XferPool *)arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&pool->next, 1)) < pool->count) {
+        XferJob *job = &pool->jobs[i];
+        int rc = pool->import ? fs_import(job->host, job->name)
+                              : fs_export(job->name, job->host);
+        if (rc == FS_OK) {
+            atomic_fetch_add(&pool->done, 1);
+        } else {
+            pool_fail(pool, rc);
+        }
+    }
+    return NULL;
+}
+
+static int run_pool(XferPool *pool, size_t *out_files) {
+    pthread_t threads[FS_XFER_THREADS];
+    int started = 0;
+
+    for (int t = 0; t < FS_XFER_THREADS && (size_t)t < pool->count; ++t) {
+        if (pthread_create(&threads[t], NULL, pool_worker, pool) != 0) break;
+        ++started;
+    }
+    if (started == 0) {
+        pool_worker(pool);
+    }
+    for (int t = 0; t < started; ++t) {
+        pthread_join(threads[t], NULL);
+    }
+
+    if (out_files) *out_files = atomic_load(&pool->done);
+    free(pool->jobs);
+    return atomic_load(&pool->error);
+}
+
+static void collect_tree(XferPool *pool, const char *host_dir,
+                         const char *name_prefix) {
+    DIR *d = opendir(host_dir);
+    if (!d) {
+        pool_fail(pool, FS_ERR_IO);
+        return;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+            continue;
+        }
+
+        char host[XFER_PATH_MAX];
+        char name[XFER_PATH_MAX];
+        if (snprintf(host, sizeof(host), "%s/%s", host_dir, ent->d_name)
+                >= (int)sizeof(host) ||
+            snprintf(name, sizeof(name), "%s%s", name_prefix, ent->d_name)
+                >= (int)sizeof(name)) {
+            pool_fail(pool, FS_ERR_INVALID_ARGUMENT);
+            continue;
+        }
+
+        struct stat st;
+        if (lstat(host, &st) != 0) {
+            pool_fail(pool, FS_ERR_IO);
+            continue;
+        }
+
+        if (S_ISDIR(st.st_mode)) {
+            strncat(name, "/", sizeof(name) - strlen(name) - 1);
+            collect_tree(pool, host, name);
+        } else if (S_ISREG(st.st_mode)) {
+            if (strlen(name) >= FS_MAX_FILENAME) {
+                pool_fail(pool, FS_ERR_INVALID_ARGUMENT);
+                continue;
+            }
+            XferJob *job = pool_add(pool);
+            if (!job) {
+                pool_fail(pool, FS_ERR_IO);
+                continue;
+            }
+            strcpy(job->host, host);
+            strcpy(job->name, name);
+        }
+    }
+    closedir(d);
+}
+
+int fs_import_tree(const char *host_dir, const char *prefix, size_t *out_files) {
+    if (out_files) *out_files = 0;
+    if (!host_dir) return FS_ERR_INVALID_ARGUMENT;
+
+    XferPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.import = 1;
+    atomic_init(&pool.next, 0);
+    atomic_init(&pool.done, 0);
+    atomic_init(&pool.error, FS_OK);
+
+    collect_tree(&pool, host_dir, prefix ? prefix : "");
+    return run_pool(&pool, out_files);
+}
+
+/* Names are used as relative host paths; refuse ones that climb out */
+static int is_safe_relative(const char *name) {
+    const char *p = name;
+    while (*p) {
+        const char *slash = strchr(p, '/');
+        size_t len = slash ? (size_t)(slash - p) : strlen(p);
+        if (len == 2 && p[0] == '.' && p[1] == '.') return 0;
+        if (!slash) break;
+        p = slash + 1;
+    }
+    return 1;
+}
+
+/* Creates every missing directory leading up to the file at 'path' */
+static int make_parent_dirs(char *path) {
+    for (char *p = strchr(path + 1, '/'); p; p = strchr(p + 1, '/')) {
+        *p = '\0';
+        int rc = mkdir(path, 0755);
+        *p = '/';
+        if (rc != 0 && errno != EEXIST) return FS_ERR_IO;
+    }
+    return FS_OK;
+}
+
+int fs_export_all(const char *host_dir, size_t *out_files) {
+    if (out_files) *out_files = 0;
+    if (!host_dir) return FS_ERR_INVALID_ARGUMENT;
+
+    if (mkdir(host_dir, 0755) != 0 && errno != EEXIST) return FS_ERR_IO;
+
+    char   names[FS_MAX_FILES][FS_MAX_FILENAME];
+    size_t count = 0;
+    int rc = fs_list_names(names, FS_MAX_FILES, &count);
+    if (rc != FS_OK) return rc;
+    if (count > FS_MAX_FILES) count = FS_MAX_FILES;
+
+    XferPool pool;
+    memset(&pool, 0, sizeof(pool));
+    pool.import = 0;
+    atomic_init(&pool.next, 0);
+    atomic_init(&pool.done, 0);
+    atomic_init(&pool.error, FS_OK);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (!is_safe_relative(names[i])) {
+            pool_fail(&pool, FS_ERR_INVALID_ARGUMENT);
+            continue;
+        }
+        XferJob *job = pool_add(&pool);
+        if (!job) {
+            pool_fail(&pool, FS_ERR_IO);
+            break;
+        }
+        strcpy(job->name, names[i]);
+        if (snprintf(job->host, sizeof(job->host), "%s/%s", host_dir, names[i])
+                >= (int)sizeof(job->host) ||
+            make_parent_dirs(job->host) != FS_OK) {
+            pool_fail(&pool, FS_ERR_IO);
+            --pool.count;
+        }
+    }
+
+    return run_pool(&pool, out_files);
+}
@@ -0,0 +1,14 @@
+#ifndef TRANSFER_H
+#define TRANSFER_H
+
+#include "filesystem.h"
+
+/* --- Bulk copy between the host and the volume ---
+ * The fs_import/fs_export API is declared in filesystem.h. */
+
+#define FS_XFER_CHUNK    (256 * 1024)   /* Bytes per host read/write     */
+#define FS_XFER_ALIGN    4096           /* Buffer alignment              */
+#define FS_XFER_DEPTH    4              /* Chunks in flight per file     */
+#define FS_XFER_THREADS  4              /* Files copied at the same time */
+
+#endif
@@ -0,0 +1,229 @@
+#define _DEFAULT_SOURCE
+
+#include "volume.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+int volume_init(Volume *vol, int shared) {
+    if (!vol) return FS_ERR_INVALID_ARGUMENT;
+
+    pthread_mutexattr_t attr;
+    if (pthread_mutexattr_init(&attr) != 0) return FS_ERR_IO;
+    if (shared) {
+        /* Robust so a client that dies holding the lock does not
+         * wedge every other process on the volume */
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    }
+    int rc = pthread_mutex_init(&vol->lock, &attr);
+    if (rc == 0) {
+        rc = pthread_mutex_init(&vol->gate.lock, &attr);
+        if (rc != 0) pthread_mutex_destroy(&vol->lock);
+    }
+    pthread_mutexattr_destroy(&attr);
+    if (rc != 0) return FS_ERR_IO;
+
+    atomic_init(&vol->gate.closed_by, 0);
+    for (int i = 0; i < FS_GATE_SLOTS; ++i) {
+        atomic_init(&vol->gate.slot[i].pid, 0);
+    }
+
+    bm_init(&vol->bm, shared);
+    dir_init(&vol->dir);
+    vol->block_shift = FS_BLOCK_SHIFT;
+    vol->magic = FS_VOLUME_MAGIC;
+    return FS_OK;
+}
+
+/* A pid that fails kill(pid, 0) with ESRCH is gone. A recycled pid can
+ * make a dead holder look alive; the checker then waits for that
+ * process to exit. */
+static int process_alive(pid_t pid) {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+static void gate_pause(void) {
+    struct timespec ts = { 0, 1000000 };    /* 1 ms */
+    nanosleep(&ts, NULL);
+}
+
+/* Slot a thread tries first, so threads do not all race for slot 0 */
+static atomic_uint        g_slot_seed = 0;
+static _Thread_local int  t_slot_hint = -1;
+
+int volume_gate_enter(Volume *vol) {
+    AllocGate *g = &vol->gate;
+    int self = (int)getpid();
+
+    if (t_slot_hint < 0) {
+        t_slot_hint = (int)(((unsigned)self + atomic_fetch_add(&g_slot_seed, 1))
+                            % FS_GATE_SLOTS);
+    }
+
+    for (;;) {
+        int closer = atomic_load(&g->closed_by);
+        if (closer != 0) {
+            if (!process_alive(closer)) {
+                /* Checker died with the gate shut */
+                atomic_compare_exchange_strong(&g->closed_by, &closer, 0);
+            } else {
+                gate_pause();
+            }
+            continue;
+        }
+
+        for (int k = 0; k < FS_GATE_SLOTS; ++k) {
+            int i = (t_slot_hint + k) % FS_GATE_SLOTS;
+            int expected = 0;
+            if (!atomic_compare_exchange_strong(&g->slot[i].pid, &expected, self)) {
+                continue;
+            }
+            /* A checker that closed the gate meanwhile either sees this
+             * slot or is seen here; both accesses are sequentially
+             * consistent */
+            if (atomic_load(&g->closed_by) == 0) {
+                t_slot_hint = i;
+                return i;
+            }
+            atomic_store(&g->slot[i].pid, 0);
+            break;
+        }
+        gate_pause();
+    }
+}
+
+void volume_gate_leave(Volume *vol, int slot) {
+    if (slot < 0 || slot >= FS_GATE_SLOTS) return;
+    atomic_store(&vol->gate.slot[slot].pid, 0);
+}
+
+void volume_gate_close(Volume *vol) {
+    AllocGate *g = &vol->gate;
+
+    /* Held until volume_gate_open. A checker that died holding it left
+     * closed_by behind, which is overwritten below. */
+    if (pthread_mutex_lock(&g->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&g->lock);
+    }
+    atomic_store(&g->closed_by, (int)getpid());
+
+    /* Wait for the calls already inside, forgetting those of dead clients */
+    for (;;) {
+        int busy = 0;
+        for (int i = 0; i < FS_GATE_SLOTS; ++i) {
+            int pid = atomic_load(&g->slot[i].pid);
+            if (pid == 0) continue;
+            if (process_alive(pid)) {
+                ++busy;
+            } else {
+                atomic_compare_exchange_strong(&g->slot[i].pid, &pid, 0);
+            }
+        }
+        if (busy == 0) return;
+        gate_pause();
+    }
+}
+
+void volume_gate_open(Volume *vol) {
+    atomic_store(&vol->gate.closed_by, 0);
+    pthread_mutex_unlock(&vol->gate.lock);
+}
+
+Volume *volume_create_private(void) {
+    void *p = mmap(NULL, sizeof(Volume), PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+
+    Volume *vol = (Volume *)p;
+    if (volume_init(vol, 0) != FS_OK) {
+        munmap(p, sizeof(Volume));
+        return NULL;
+    }
+    return vol;
+}
+
+void volume_destroy_private(Volume *vol) {
+    if (!vol) return;
+    pthread_mutex_destroy(&vol->gate.lock);
+    pthread_mutex_destroy(&vol->lock);
+    munmap(vol, sizeof(Volume));
+}
+
+static Volume *map_segment(int fd) {
+    void *p = mmap(NULL, sizeof(Volume), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : (Volume *)p;
+}
+
+int volume_create_shared(const char *name, int replace, Volume **out_vol) {
+    if (!name || !out_vol) return FS_ERR_INVALID_ARGUMENT;
+    *out_vol = NULL;
+
+    if (replace) {
+        /* Processes still mapping the old segment keep it, cut off */
+        shm_unlink(name);
+    }
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        return errno == EEXIST ? FS_ERR_FILE_EXISTS : FS_ERR_IO;
+    }
+
+    if (ftruncate(fd, (off_t)sizeof(Volume)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return FS_ERR_IO;
+    }
+
+    Volume *vol = map_segment(fd);
+    if (!vol) {
+        shm_unlink(name);
+        return FS_ERR_IO;
+    }
+
+    if (volume_init(vol, 1) != FS_OK) {
+        volume_detach_shared(vol);
+        shm_unlink(name);
+        return FS_ERR_IO;
+    }
+    *out_vol = vol;
+    return FS_OK;
+}
+
+Volume *volume_attach_shared(const char *name) {
+    if (!name) return NULL;
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != sizeof(Volume)) {
+        close(fd);
+        return NULL;
+    }
+
+    Volume *vol = map_segment(fd);
+    if (vol && (vol->magic != FS_VOLUME_MAGIC ||
+                vol->block_shift != FS_BLOCK_SHIFT)) {
+        /* Not a volume, or formatted with another geometry profile */
+        volume_detach_shared(vol);
+        return NULL;
+    }
+    return vol;
+}
+
+void volume_detach_shared(Volume *vol) {
+    if (!vol) return;
+    munmap(vol, sizeof(Volume));
+}
+
+int volume_unlink_shared(const char *name) {
+    if (!name) return FS_ERR_INVALID_ARGUMENT;
+    return shm_unlink(name) == 0 ? FS_OK : FS_ERR_IO;
+}
@@ -0,0 +1,84 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "filesystem.h"
+#include "storage.h"
+#include "block_manager.h"
+#include "directory.h"
+
+#define FS_VOLUME_MAGIC 0x31534653u   /* "SFS1" */
+
+#define FS_GATE_SLOTS   64            /* Concurrent creates/deletes */
+
+/* Tracks the create/delete calls that hold blocks outside the volume lock.
+ * Each one claims a slot by storing its pid there, so a checker can tell
+ * the calls of a dead client from live ones instead of waiting on them.
+ * Slots sit on cache lines of their own and are taken with a CAS; only
+ * checkers use the lock. */
+typedef struct {
+    _Alignas(FS_CACHE_LINE)
+    atomic_int       pid;             /* Holder, or 0 if free */
+} GateSlot;
+
+typedef struct {
+    pthread_mutex_t  lock;            /* Robust; one checker at a time   */
+    atomic_int       closed_by;       /* Checker's pid, or 0 when open   */
+    GateSlot         slot[FS_GATE_SLOTS];
+} AllocGate;
+
+/* Complete state of a mounted filesystem. It holds no pointers, so it can
+ * be mapped at a different address in every process that shares it. */
+typedef struct {
+    unsigned int     magic;
+    unsigned int     block_shift;     /* Geometry profile it was built with */
+    pthread_mutex_t  lock;            /* Serializes fs_* calls           */
+    AllocGate        gate;            /* Creates/deletes with blocks in
+                                         flight; closed by fs_check      */
+    BlockManager     bm;
+    Directory        dir;
+    Storage          storage;
+} Volume;
+
+/* Formats a volume in constant time; 'shared' makes its locks usable
+ * across processes. Block contents are left alone, so a volume from a
+ * fresh mapping reads as zeros and one formatted in place keeps old data
+ * in its free blocks. */
+int     volume_init(Volume *vol, int shared);
+
+/* Takes a gate slot before allocating or freeing blocks outside the
+ * volume lock; waits while a checker has the gate closed */
+int     volume_gate_enter(Volume *vol);
+
+/* Gives back a slot taken by volume_gate_enter */
+void    volume_gate_leave(Volume *vol, int slot);
+
+/* Closes the gate and waits until no live process holds a slot. Slots of
+ * dead processes are dropped; their blocks show up as leaked. */
+void    volume_gate_close(Volume *vol);
+
+/* Reopens the gate after volume_gate_close (same thread) */
+void    volume_gate_open(Volume *vol);
+
+/* Maps and formats a private volume; pages are zero-filled on demand */
+Volume *volume_create_private(void);
+
+/* Unmaps a private volume */
+void    volume_destroy_private(Volume *vol);
+
+/* Creates a named shared-memory volume and maps it. Fails with
+ * FS_ERR_FILE_EXISTS if the name is taken, unless 'replace' is set. */
+int     volume_create_shared(const char *name, int replace, Volume **out_vol);
+
+/* Maps an existing named shared-memory volume */
+Volume *volume_attach_shared(const char *name);
+
+/* Unmaps a shared volume (the segment itself stays alive) */
+void    volume_detach_shared(Volume *vol);
+
+/* Removes the name of a shared volume; mapped processes keep working */
+int     volume_unlink_shared(const char *name);
+
+#endif